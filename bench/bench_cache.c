@@ -0,0 +1,168 @@
+/* bench_cache.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "roman_calculator.h"
+
+/*
+ * Compares roman_add with roman_cache_add on a skewed workload: pairs of
+ * numerals are drawn from a Zipf distribution (the k-th most popular pair
+ * being chosen with probability proportional to 1 / k^s), the way years and
+ * chapter numbers dominate real traffic. The cache is measured at several
+ * capacities, each starting empty, so its hit rate includes warming up.
+ *
+ * Usage: bench_cache [number of distinct pairs] [exponent s]
+ */
+
+#define NUMBER_OF_REQUESTS 2000000
+#define MAXIMUM_VALUE 3999
+
+typedef struct {
+    char numeral1[32];
+    char numeral2[32];
+} numeral_pair;
+
+static void   draw_requests(size_t *requests, size_t number_of_pairs,
+                            double exponent);
+static double time_uncached(const numeral_pair *pairs,
+                            const size_t *requests);
+static double time_cached(const numeral_pair *pairs, const size_t *requests,
+                          size_t capacity, roman_cache_stats *stats);
+static double seconds_since(const struct timespec *start);
+
+int main(int argc, char **argv)
+{
+    const size_t capacities[] = {256, 4096, 65536};
+    size_t number_of_pairs = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10000;
+    double exponent = (argc > 2) ? atof(argv[2]) : 1.1;
+    numeral_pair *pairs;
+    size_t *requests;
+    roman_cache_stats stats;
+    double seconds;
+
+    size_t pair;
+    size_t capacity;
+
+    if (number_of_pairs == 0) number_of_pairs = 1;
+    pairs = malloc(number_of_pairs * sizeof(numeral_pair));
+    requests = malloc(NUMBER_OF_REQUESTS * sizeof(size_t));
+    if (!pairs || !requests) {
+        fprintf(stderr, "bench_cache: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(12345);
+    for (pair = 0; pair < number_of_pairs; pair++) {
+        u64_to_roman(rand() % MAXIMUM_VALUE + 1, pairs[pair].numeral1,
+                     sizeof(pairs[pair].numeral1));
+        u64_to_roman(rand() % MAXIMUM_VALUE + 1, pairs[pair].numeral2,
+                     sizeof(pairs[pair].numeral2));
+    }
+    draw_requests(requests, number_of_pairs, exponent);
+
+    printf("%lu requests over %lu pairs, Zipf exponent %.2f\n",
+           (unsigned long)NUMBER_OF_REQUESTS, (unsigned long)number_of_pairs,
+           exponent);
+    printf("%-18s %10s %10s\n", "", "ns/op", "hit rate");
+
+    seconds = time_uncached(pairs, requests);
+    printf("%-18s %10.1f %10s\n", "uncached",
+           seconds * 1e9 / NUMBER_OF_REQUESTS, "-");
+
+    for (capacity = 0; capacity < sizeof(capacities) / sizeof(size_t);
+         capacity++) {
+        seconds = time_cached(pairs, requests, capacities[capacity], &stats);
+        printf("cache of %-9lu %10.1f %9.1f%%\n",
+               (unsigned long)capacities[capacity],
+               seconds * 1e9 / NUMBER_OF_REQUESTS,
+               100.0 * stats.hits / (stats.hits + stats.misses));
+    }
+
+    free(pairs);
+    free(requests);
+    return EXIT_SUCCESS;
+}
+
+/** Inverse transform sampling over the cumulative Zipf distribution */
+static void draw_requests(size_t *requests, size_t number_of_pairs,
+                          double exponent)
+{
+    double *cumulative = malloc(number_of_pairs * sizeof(double));
+    double total = 0;
+    double target;
+    size_t low;
+    size_t high;
+    size_t middle;
+
+    size_t pair;
+    size_t request;
+
+    for (pair = 0; pair < number_of_pairs; pair++) {
+        total += 1.0 / pow((double)(pair + 1), exponent);
+        cumulative[pair] = total;
+    }
+
+    for (request = 0; request < NUMBER_OF_REQUESTS; request++) {
+        target = (double)rand() / ((double)RAND_MAX + 1) * total;
+        low = 0;
+        high = number_of_pairs - 1;
+        while (low < high) {
+            middle = low + (high - low) / 2;
+            if (cumulative[middle] <= target) low = middle + 1;
+            else high = middle;
+        }
+        requests[request] = low;
+    }
+    free(cumulative);
+}
+
+static double time_uncached(const numeral_pair *pairs,
+                            const size_t *requests)
+{
+    struct timespec start;
+    char *sum;
+
+    size_t request;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (request = 0; request < NUMBER_OF_REQUESTS; request++) {
+        roman_add(pairs[requests[request]].numeral1,
+                  pairs[requests[request]].numeral2, &sum);
+        free(sum);
+    }
+    return seconds_since(&start);
+}
+
+static double time_cached(const numeral_pair *pairs, const size_t *requests,
+                          size_t capacity, roman_cache_stats *stats)
+{
+    roman_cache *cache = roman_cache_create(capacity);
+    struct timespec start;
+    double seconds;
+    const char *sum;
+
+    size_t request;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (request = 0; request < NUMBER_OF_REQUESTS; request++) {
+        roman_cache_add(cache, pairs[requests[request]].numeral1,
+                        pairs[requests[request]].numeral2, &sum);
+        roman_cache_release(sum);
+    }
+    seconds = seconds_since(&start);
+
+    roman_cache_get_stats(cache, stats);
+    roman_cache_destroy(cache);
+    return seconds;
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,174 @@
+/* bench_column.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "roman_calculator.h"
+
+/*
+ * Compares decoding a column of numerals with roman_decode_column against
+ * copying each numeral out of the column to '\0'-terminate it and handing it
+ * to roman_to_u64 (or roman_validate and roman_to_u64 in strict mode). Columns
+ * hold short canonical numerals (up to 3999) or long ones with runs of 'M'.
+ *
+ * Usage: bench_column [number of numerals]
+ */
+
+#define REPETITIONS 20
+#define MAXIMUM_VALUE 3999
+
+typedef struct {
+    char *data;
+    size_t *offsets;
+    size_t count;
+    size_t longest;
+} numeral_column;
+
+static void   fill_column(numeral_column *column, size_t count,
+                          size_t thousands);
+static double time_one_at_a_time(const numeral_column *column,
+                                 roman_validation mode, uint64_t *values,
+                                 roman_status *statuses);
+static double time_column(const numeral_column *column,
+                          roman_validation mode, uint64_t *values,
+                          roman_status *statuses);
+static double seconds_since(const struct timespec *start);
+
+int main(int argc, char **argv)
+{
+    const char *column_names[2] = {"short canonical", "M runs"};
+    const size_t thousands[2] = {0, 200};
+    const char *mode_names[2] = {"lenient", "strict"};
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 100000;
+    numeral_column column;
+    uint64_t *values;
+    roman_status *statuses;
+    double separately;
+    double together;
+
+    int kind;
+    int mode;
+
+    if (count == 0) count = 1;
+    values = malloc(count * sizeof(uint64_t));
+    statuses = malloc(count * sizeof(roman_status));
+    if (!values || !statuses) {
+        fprintf(stderr, "bench_column: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(12345);
+    printf("%lu numerals per column\n", (unsigned long)count);
+    printf("%-16s %-8s %14s %14s\n", "column", "mode", "ns/numeral",
+           "column ns/num");
+    for (kind = 0; kind < 2; kind++) {
+        fill_column(&column, count, thousands[kind]);
+        for (mode = ROMAN_LENIENT; mode <= ROMAN_STRICT; mode++) {
+            separately = time_one_at_a_time(&column, (roman_validation)mode,
+                                            values, statuses);
+            together = time_column(&column, (roman_validation)mode, values,
+                                   statuses);
+            printf("%-16s %-8s %14.1f %14.1f\n", column_names[kind],
+                   mode_names[mode], separately * 1e9 / count / REPETITIONS,
+                   together * 1e9 / count / REPETITIONS);
+        }
+        free(column.data);
+        free(column.offsets);
+    }
+
+    free(values);
+    free(statuses);
+    return EXIT_SUCCESS;
+}
+
+/** Numerals of up to MAXIMUM_VALUE, each preceded by thousands 'M's */
+static void fill_column(numeral_column *column, size_t count,
+                        size_t thousands)
+{
+    char numeral[32];
+    size_t length;
+
+    size_t entry;
+
+    column->data = malloc(count * (thousands + sizeof(numeral)));
+    column->offsets = malloc((count + 1) * sizeof(size_t));
+    column->count = count;
+    column->longest = 0;
+    if (!column->data || !column->offsets) {
+        fprintf(stderr, "bench_column: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    column->offsets[0] = 0;
+    for (entry = 0; entry < count; entry++) {
+        length = u64_to_roman(rand() % MAXIMUM_VALUE + 1, numeral,
+                              sizeof(numeral));
+        memset(column->data + column->offsets[entry], 'M', thousands);
+        memcpy(column->data + column->offsets[entry] + thousands, numeral,
+               length);
+        column->offsets[entry + 1] = column->offsets[entry] + thousands
+                                     + length;
+        if (thousands + length > column->longest) {
+            column->longest = thousands + length;
+        }
+    }
+}
+
+static double time_one_at_a_time(const numeral_column *column,
+                                 roman_validation mode, uint64_t *values,
+                                 roman_status *statuses)
+{
+    char *numeral = malloc(column->longest + 1);
+    struct timespec start;
+    double seconds;
+    size_t length;
+
+    int repetition;
+    size_t entry;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (repetition = 0; repetition < REPETITIONS; repetition++) {
+        for (entry = 0; entry < column->count; entry++) {
+            length = column->offsets[entry + 1] - column->offsets[entry];
+            memcpy(numeral, column->data + column->offsets[entry], length);
+            numeral[length] = '\0';
+
+            statuses[entry] = (mode == ROMAN_STRICT)
+                              ? roman_validate(numeral, ROMAN_STRICT)
+                              : ROMAN_OK;
+            if (statuses[entry] == ROMAN_OK) {
+                statuses[entry] = roman_to_u64(numeral, &values[entry]);
+            }
+        }
+    }
+    seconds = seconds_since(&start);
+
+    free(numeral);
+    return seconds;
+}
+
+static double time_column(const numeral_column *column,
+                          roman_validation mode, uint64_t *values,
+                          roman_status *statuses)
+{
+    struct timespec start;
+
+    int repetition;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (repetition = 0; repetition < REPETITIONS; repetition++) {
+        roman_decode_column(column->data, column->offsets, column->count,
+                            mode, values, statuses);
+    }
+    return seconds_since(&start);
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,135 @@
+/* bench_multiply.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "roman_calculator.h"
+
+/*
+ * Compares multiply_roman_numerals with multiplying by repeated addition, and
+ * divide_roman_numerals with dividing by repeated subtraction, the way callers
+ * had to before, for a fixed numeral and multipliers of growing size. The
+ * native functions are timed over NATIVE_REPETITIONS calls.
+ */
+
+#define MULTIPLICAND "MCMXC"
+#define NATIVE_REPETITIONS 1000
+
+static double time_native(const char *numeral1, const char *numeral2,
+                          int divide);
+static char  *repeat_addition(const char *numeral, unsigned long times);
+static char  *repeat_subtraction(const char *dividend, const char *divisor,
+                                 unsigned long *quotient);
+static double seconds_since(const struct timespec *start);
+
+int main(void)
+{
+    const unsigned long multipliers[] = {10, 100, 1000, 5000};
+    char multiplier[64];
+    struct timespec start;
+    double native;
+    double repeated;
+    char *product;
+    char *expected;
+    char *quotient;
+    unsigned long repeated_quotient;
+
+    size_t current;
+
+    printf("%-10s %-10s %14s %14s %9s\n", "multiplier", "operation",
+           "native ns", "repeated ns", "speedup");
+    for (current = 0; current < sizeof(multipliers) / sizeof(multipliers[0]);
+         current++) {
+        u64_to_roman(multipliers[current], multiplier, sizeof(multiplier));
+
+        product = multiply_roman_numerals(MULTIPLICAND, multiplier);
+        native = time_native(MULTIPLICAND, multiplier, 0);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        expected = repeat_addition(MULTIPLICAND, multipliers[current]);
+        repeated = seconds_since(&start);
+        if (!product || !expected || strcmp(product, expected) != 0) {
+            fprintf(stderr, "bench_multiply: products differ\n");
+            return EXIT_FAILURE;
+        }
+        printf("%-10lu %-10s %14.0f %14.0f %8.0fx\n", multipliers[current],
+               "multiply", native * 1e9, repeated * 1e9, repeated / native);
+
+        quotient = divide_roman_numerals(product, MULTIPLICAND, NULL);
+        native = time_native(product, MULTIPLICAND, 1);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        free(repeat_subtraction(product, MULTIPLICAND, &repeated_quotient));
+        repeated = seconds_since(&start);
+        if (!quotient || strcmp(quotient, multiplier) != 0
+            || repeated_quotient != multipliers[current]) {
+            fprintf(stderr, "bench_multiply: quotients differ\n");
+            return EXIT_FAILURE;
+        }
+        printf("%-10lu %-10s %14.0f %14.0f %8.0fx\n", multipliers[current],
+               "divide", native * 1e9, repeated * 1e9, repeated / native);
+
+        free(product);
+        free(expected);
+        free(quotient);
+    }
+    return EXIT_SUCCESS;
+}
+
+static double time_native(const char *numeral1, const char *numeral2,
+                          int divide)
+{
+    struct timespec start;
+
+    int repetition;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (repetition = 0; repetition < NATIVE_REPETITIONS; repetition++) {
+        free(divide ? divide_roman_numerals(numeral1, numeral2, NULL)
+                    : multiply_roman_numerals(numeral1, numeral2));
+    }
+    return seconds_since(&start) / NATIVE_REPETITIONS;
+}
+
+static char *repeat_addition(const char *numeral, unsigned long times)
+{
+    char *total;
+    char *next;
+
+    unsigned long addition;
+
+    total = malloc(strlen(numeral) + 1);
+    strcpy(total, numeral);
+    for (addition = 1; addition < times; addition++) {
+        next = add_roman_numerals(total, numeral);
+        free(total);
+        total = next;
+    }
+    return total;
+}
+
+/** Subtract until the difference would be negative; returns what is left. */
+static char *repeat_subtraction(const char *dividend, const char *divisor,
+                                unsigned long *quotient)
+{
+    char *remainder = malloc(strlen(dividend) + 1);
+    char *next;
+
+    strcpy(remainder, dividend);
+    *quotient = 0;
+    while (roman_subtract(remainder, divisor, &next) == ROMAN_OK) {
+        free(remainder);
+        remainder = next;
+        (*quotient)++;
+        if (*remainder == '\0') break;
+    }
+    return remainder;
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,327 @@
+/* bench_pipeline.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "roman_calculator_internal.h"
+
+/*
+ * Measures the latency of add_roman_numerals, subtract_roman_numerals and of
+ * each internal stage they are made of, for several classes of input. Calls
+ * are timed in small batches; the percentiles reported are over the batches'
+ * nanoseconds per call. Allocations are counted by wrapping malloc, calloc
+ * and realloc at link time (see the bench target in the Makefile).
+ */
+
+#define NUMBER_OF_SAMPLES 2000
+#define NANOSECONDS_PER_SAMPLE 2000.0
+
+typedef struct {
+    const char *name;
+    char *numeral1;
+    char *numeral2;
+} input_class;
+
+typedef enum {
+    ADD, SUBTRACT, ARENA_ADD, ADD_LENGTH, COUNT_CHARACTERS,
+    COMPUTE_CARRYOVERS, BORROW, RENDER, RENDERED_LENGTH, TO_U64, FROM_U64,
+    VALIDATE_LENIENT, VALIDATE_STRICT,
+    NUMBER_OF_OPERATIONS
+} operation;
+
+typedef struct {
+    const input_class *input;
+    int summed_counts[7];
+    int subtracted_counts[7];
+    int carried_counts[7];
+    uint64_t value1;
+    char *text;
+    size_t text_capacity;
+    roman_arena *arena;
+} operation_arguments;
+
+static unsigned long allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+static char  *repeat_numeral(const char *numeral, size_t copies,
+                             const char *suffix);
+static void   prepare_arguments(const input_class *input,
+                                operation_arguments *arguments);
+static void   run_operation(operation current,
+                            const operation_arguments *arguments);
+static void   measure(operation current, const operation_arguments *arguments,
+                      double *percentiles, double *allocations_per_call);
+static long   calls_per_sample(operation current,
+                               const operation_arguments *arguments);
+static int    compare_doubles(const void *value1, const void *value2);
+static double nanoseconds_since(const struct timespec *start);
+
+int main(void)
+{
+    const char *operation_names[NUMBER_OF_OPERATIONS] = {
+        "add", "subtract", "arena_add", "add_length", "count", "carryovers",
+        "borrow", "render", "length", "to_u64", "from_u64", "lenient",
+        "strict"
+    };
+    input_class inputs[4];
+    operation_arguments arguments;
+    double percentiles[3];
+    double allocations_per_call;
+
+    size_t input;
+    int current;
+
+    inputs[0].name = "short canonical";
+    inputs[0].numeral1 = repeat_numeral("XXVIII", 1, "");
+    inputs[0].numeral2 = repeat_numeral("XIV", 1, "");
+    inputs[1].name = "subtractive";
+    inputs[1].numeral1 = repeat_numeral("MCMXCIX", 1, "");
+    inputs[1].numeral2 = repeat_numeral("CDXLIV", 1, "");
+    inputs[2].name = "long additive";
+    inputs[2].numeral1 = repeat_numeral("DCLXVI", 100, "");
+    inputs[2].numeral2 = repeat_numeral("DCLXVI", 50, "");
+    inputs[3].name = "M run";
+    inputs[3].numeral1 = repeat_numeral("M", 10000, "CMXCIX");
+    inputs[3].numeral2 = repeat_numeral("M", 5000, "CDXLIV");
+
+    printf("%-16s %-11s %10s %10s %10s %10s\n", "input", "operation",
+           "p50 ns", "p90 ns", "p99 ns", "allocs/op");
+    for (input = 0; input < sizeof(inputs) / sizeof(inputs[0]); input++) {
+        prepare_arguments(&inputs[input], &arguments);
+        for (current = ADD; current < NUMBER_OF_OPERATIONS; current++) {
+            measure((operation)current, &arguments, percentiles,
+                    &allocations_per_call);
+            printf("%-16s %-11s %10.1f %10.1f %10.1f %10.2f\n",
+                   inputs[input].name, operation_names[current],
+                   percentiles[0], percentiles[1], percentiles[2],
+                   allocations_per_call);
+        }
+        free(inputs[input].numeral1);
+        free(inputs[input].numeral2);
+        free(arguments.text);
+        roman_arena_destroy(arguments.arena);
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Allocation counting
+ */
+
+void *__wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    allocations++;
+    return __real_realloc(pointer, size);
+}
+
+/*
+ * Running and timing operations
+ */
+
+static char *repeat_numeral(const char *numeral, size_t copies,
+                            const char *suffix)
+{
+    size_t numeral_length = strlen(numeral);
+    char *result = malloc(numeral_length * copies + strlen(suffix) + 1);
+
+    size_t copy;
+    for (copy = 0; copy < copies; copy++) {
+        memcpy(result + copy * numeral_length, numeral, numeral_length);
+    }
+    strcpy(result + copies * numeral_length, suffix);
+    return result;
+}
+
+/**
+ * Run the stages once by hand to get the character counts each of them
+ * starts from: the counts of both numerals together (before carryovers),
+ * the difference of their carried-over counts (before borrowing) and the
+ * carried-over sum.
+ */
+static void prepare_arguments(const input_class *input,
+                              operation_arguments *arguments)
+{
+    int counts2[7] = {0};
+
+    int index;
+
+    arguments->input = input;
+    memset(arguments->summed_counts, 0, sizeof(arguments->summed_counts));
+    roman_stage_count_characters(input->numeral1, arguments->summed_counts);
+    memcpy(arguments->subtracted_counts, arguments->summed_counts,
+           sizeof(arguments->subtracted_counts));
+    roman_stage_count_characters(input->numeral2, arguments->summed_counts);
+
+    roman_stage_count_characters(input->numeral2, counts2);
+    roman_stage_compute_carryovers(arguments->subtracted_counts);
+    roman_stage_compute_carryovers(counts2);
+    for (index = 0; index < 7; index++) {
+        arguments->subtracted_counts[index] -= counts2[index];
+    }
+
+    memcpy(arguments->carried_counts, arguments->summed_counts,
+           sizeof(arguments->carried_counts));
+    roman_stage_compute_carryovers(arguments->carried_counts);
+
+    roman_to_u64(input->numeral1, &arguments->value1);
+    arguments->text_capacity = roman_len_for(arguments->value1) + 1;
+    arguments->text = malloc(arguments->text_capacity);
+    arguments->arena = roman_arena_create(0);
+}
+
+/**
+ * Stages that change their counts in place work on a copy, so the cost of
+ * copying seven ints is included in their timings.
+ */
+static void run_operation(operation current,
+                          const operation_arguments *arguments)
+{
+    int character_counts[7] = {0};
+    char *result = NULL;
+    const char *arena_result;
+    size_t length;
+    uint64_t value = 0;
+
+    switch (current) {
+        case ADD:
+            result = add_roman_numerals(arguments->input->numeral1,
+                                        arguments->input->numeral2);
+            break;
+        case SUBTRACT:
+            result = subtract_roman_numerals(arguments->input->numeral1,
+                                             arguments->input->numeral2);
+            break;
+        case ARENA_ADD:
+            roman_arena_add(arguments->arena, arguments->input->numeral1,
+                            arguments->input->numeral2, &arena_result);
+            roman_arena_reset(arguments->arena);
+            break;
+        case ADD_LENGTH:
+            roman_add_length(arguments->input->numeral1,
+                             arguments->input->numeral2, &length);
+            value = length;
+            break;
+        case COUNT_CHARACTERS:
+            roman_stage_count_characters(arguments->input->numeral1,
+                                         character_counts);
+            break;
+        case COMPUTE_CARRYOVERS:
+            memcpy(character_counts, arguments->summed_counts,
+                   sizeof(character_counts));
+            roman_stage_compute_carryovers(character_counts);
+            break;
+        case BORROW:
+            memcpy(character_counts, arguments->subtracted_counts,
+                   sizeof(character_counts));
+            roman_stage_borrow(character_counts);
+            break;
+        case RENDER:
+            result = roman_stage_render(arguments->carried_counts);
+            break;
+        case RENDERED_LENGTH:
+            value = roman_stage_rendered_length(arguments->carried_counts);
+            break;
+        case TO_U64:
+            roman_to_u64(arguments->input->numeral1, &value);
+            break;
+        case FROM_U64:
+            u64_to_roman(arguments->value1, arguments->text,
+                         arguments->text_capacity);
+            break;
+        case VALIDATE_LENIENT:
+            value = roman_validate(arguments->input->numeral1, ROMAN_LENIENT);
+            break;
+        case VALIDATE_STRICT:
+            value = roman_validate(arguments->input->numeral1, ROMAN_STRICT);
+            break;
+        default:
+            break;
+    }
+
+    /* Keep the compiler from discarding stages whose results go unused. */
+    __asm__ __volatile__("" : : "r"(character_counts), "r"(value)
+                         : "memory");
+    free(result);
+}
+
+static void measure(operation current, const operation_arguments *arguments,
+                    double *percentiles, double *allocations_per_call)
+{
+    static double samples[NUMBER_OF_SAMPLES];
+    long calls = calls_per_sample(current, arguments);
+    unsigned long allocations_before = allocations;
+    struct timespec start;
+
+    int sample;
+    long call;
+
+    for (sample = 0; sample < NUMBER_OF_SAMPLES; sample++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (call = 0; call < calls; call++) {
+            run_operation(current, arguments);
+        }
+        samples[sample] = nanoseconds_since(&start) / calls;
+    }
+
+    *allocations_per_call = (double)(allocations - allocations_before)
+                            / ((double)NUMBER_OF_SAMPLES * calls);
+
+    qsort(samples, NUMBER_OF_SAMPLES, sizeof(double), compare_doubles);
+    percentiles[0] = samples[NUMBER_OF_SAMPLES * 50 / 100];
+    percentiles[1] = samples[NUMBER_OF_SAMPLES * 90 / 100];
+    percentiles[2] = samples[NUMBER_OF_SAMPLES * 99 / 100];
+}
+
+/**
+ * Enough calls to make a sample last about NANOSECONDS_PER_SAMPLE, so that
+ * reading the clock does not dominate the fastest stages.
+ */
+static long calls_per_sample(operation current,
+                             const operation_arguments *arguments)
+{
+    struct timespec start;
+    double nanoseconds_per_call;
+
+    int call;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (call = 0; call < 100; call++) {
+        run_operation(current, arguments);
+    }
+    nanoseconds_per_call = nanoseconds_since(&start) / 100;
+
+    if (nanoseconds_per_call >= NANOSECONDS_PER_SAMPLE) return 1;
+    return (long)(NANOSECONDS_PER_SAMPLE / nanoseconds_per_call) + 1;
+}
+
+static int compare_doubles(const void *value1, const void *value2)
+{
+    double difference = *(const double *)value1 - *(const double *)value2;
+    return (difference > 0) - (difference < 0);
+}
+
+static double nanoseconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e9
+           + (now.tv_nsec - start->tv_nsec);
+}
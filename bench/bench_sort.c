@@ -0,0 +1,113 @@
+/* bench_sort.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "roman_calculator.h"
+
+/*
+ * Compares roman_sort with qsort calling roman_compare, and with qsort
+ * calling a comparison that subtracts the numerals with roman_subtract (the
+ * only way to order them before roman_compare), on arrays of numerals up to
+ * 3999 in random order.
+ *
+ * Usage: bench_sort [number of numerals]
+ */
+
+#define MAXIMUM_VALUE 3999
+#define NUMERAL_SIZE 16
+
+static int    compare_by_value(const void *numeral1, const void *numeral2);
+static int    compare_by_subtracting(const void *numeral1,
+                                     const void *numeral2);
+static double seconds_since(const struct timespec *start);
+
+int main(int argc, char **argv)
+{
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    char *storage;
+    const char **original;
+    const char **numerals;
+    struct timespec start;
+    double seconds;
+
+    size_t index;
+
+    if (count == 0) count = 1;
+    storage = malloc(count * NUMERAL_SIZE);
+    original = malloc(count * sizeof(const char *));
+    numerals = malloc(count * sizeof(const char *));
+    if (!storage || !original || !numerals) {
+        fprintf(stderr, "bench_sort: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(12345);
+    for (index = 0; index < count; index++) {
+        u64_to_roman(rand() % MAXIMUM_VALUE + 1, storage + index * NUMERAL_SIZE,
+                     NUMERAL_SIZE);
+        original[index] = storage + index * NUMERAL_SIZE;
+    }
+
+    printf("%lu numerals\n", (unsigned long)count);
+    printf("%-22s %10s %12s\n", "", "ms", "ns/numeral");
+
+    memcpy(numerals, original, count * sizeof(const char *));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    roman_sort(numerals, count, NULL);
+    seconds = seconds_since(&start);
+    printf("%-22s %10.1f %12.1f\n", "roman_sort", seconds * 1e3,
+           seconds * 1e9 / count);
+
+    memcpy(numerals, original, count * sizeof(const char *));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    qsort(numerals, count, sizeof(const char *), compare_by_value);
+    seconds = seconds_since(&start);
+    printf("%-22s %10.1f %12.1f\n", "qsort, roman_compare", seconds * 1e3,
+           seconds * 1e9 / count);
+
+    memcpy(numerals, original, count * sizeof(const char *));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    qsort(numerals, count, sizeof(const char *), compare_by_subtracting);
+    seconds = seconds_since(&start);
+    printf("%-22s %10.1f %12.1f\n", "qsort, roman_subtract", seconds * 1e3,
+           seconds * 1e9 / count);
+
+    free(storage);
+    free(original);
+    free(numerals);
+    return EXIT_SUCCESS;
+}
+
+static int compare_by_value(const void *numeral1, const void *numeral2)
+{
+    int order;
+    roman_compare(*(const char *const *)numeral1,
+                  *(const char *const *)numeral2, &order);
+    return order;
+}
+
+static int compare_by_subtracting(const void *numeral1, const void *numeral2)
+{
+    char *difference;
+    int order;
+
+    if (roman_subtract(*(const char *const *)numeral1,
+                       *(const char *const *)numeral2, &difference)
+        == ROMAN_ERR_NEGATIVE_RESULT) {
+        return -1;
+    }
+    order = (difference[0] != '\0');
+    free(difference);
+    return order;
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
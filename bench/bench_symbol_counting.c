@@ -0,0 +1,114 @@
+/* bench_symbol_counting.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "roman_calculator_internal.h"
+
+/*
+ * Measures how fast long numerals are counted, in bytes per second, with the
+ * scalar loop and with each vector instruction set.
+ */
+
+#define MINIMUM_SECONDS_PER_MEASUREMENT 0.2
+
+static char  *repeat_pattern(const char *pattern, size_t length);
+static double bytes_per_second(const char *numeral, size_t length,
+                               roman_simd_level level);
+static double seconds_since(const struct timespec *start);
+
+int main(void)
+{
+    const char *pattern_names[] = {"M run", "additive", "subtractive"};
+    const char *patterns[] = {"M", "MDCLXVI", "MCMXLIVI"};
+    const size_t lengths[] = {1024, 64 * 1024, 1024 * 1024};
+    const char *level_names[] = {"scalar", "SSE2", "AVX2"};
+
+    char *numeral;
+    double scalar_rate;
+    double rate;
+
+    size_t pattern;
+    size_t length;
+    int level;
+
+    printf("%-12s %9s %8s %12s %8s\n", "input", "bytes", "path", "MB/s",
+           "speedup");
+    for (pattern = 0; pattern < 3; pattern++) {
+        for (length = 0; length < 3; length++) {
+            numeral = repeat_pattern(patterns[pattern], lengths[length]);
+
+            scalar_rate = 0;
+            for (level = ROMAN_SIMD_NONE; level <= ROMAN_SIMD_AVX2; level++) {
+                roman_limit_simd_level((roman_simd_level)level);
+                if (roman_active_simd_level() != (roman_simd_level)level) {
+                    continue;
+                }
+
+                rate = bytes_per_second(numeral, lengths[length],
+                                        (roman_simd_level)level);
+                if (level == ROMAN_SIMD_NONE) scalar_rate = rate;
+
+                printf("%-12s %9lu %8s %12.1f %7.2fx\n",
+                       pattern_names[pattern],
+                       (unsigned long)lengths[length], level_names[level],
+                       rate / 1e6, rate / scalar_rate);
+            }
+            free(numeral);
+        }
+    }
+    roman_limit_simd_level(ROMAN_SIMD_AVX2);
+    return EXIT_SUCCESS;
+}
+
+static char *repeat_pattern(const char *pattern, size_t length)
+{
+    char *numeral = malloc(length + 1);
+    size_t pattern_length = strlen(pattern);
+
+    size_t offset;
+    for (offset = 0; offset < length; offset++) {
+        numeral[offset] = pattern[offset % pattern_length];
+    }
+    numeral[length] = '\0';
+    return numeral;
+}
+
+/**
+ * Counting is timed through the public interface: with no room for a result,
+ * add_roman_numerals_into only counts characters and measures the result.
+ */
+static double bytes_per_second(const char *numeral, size_t length,
+                               roman_simd_level level)
+{
+    struct timespec start;
+    roman_status status;
+    unsigned long iterations = 0;
+    double elapsed;
+
+    roman_limit_simd_level(level);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        add_roman_numerals_into(numeral, "I", NULL, 0, &status);
+        if (status != ROMAN_OK) {
+            fprintf(stderr, "unexpected status: %s\n",
+                    roman_status_message(status));
+            exit(EXIT_FAILURE);
+        }
+        iterations++;
+        elapsed = seconds_since(&start);
+    } while (elapsed < MINIMUM_SECONDS_PER_MEASUREMENT);
+
+    return (double)length * iterations / elapsed;
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec)
+           + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,241 @@
+/* stress_threads.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "roman_calculator.h"
+
+/*
+ * Adds and subtracts every pair of numerals from I up to a bound on 1, 2, 4,
+ * ... threads at once, checking each result, and reports the aggregate
+ * throughput and its scaling relative to one thread. Every calculation is done
+ * both through the allocating interface and through a per-thread roman_ctx.
+ *
+ * Usage: stress_threads.o [bound [maximum number of threads]]
+ */
+
+#define DEFAULT_BOUND 1000
+
+typedef enum { USE_MALLOC, USE_CONTEXT } allocation_mode;
+
+typedef struct {
+    allocation_mode mode;
+    int first;
+    int stride;
+    unsigned long operations;
+    unsigned long failures;
+} worker;
+
+static char **numerals;
+static int bound;
+
+static char  **create_numerals(int count);
+static double  run_workers(allocation_mode mode, int number_of_threads,
+                           unsigned long *operations,
+                           unsigned long *failures);
+static void   *run_worker(void *argument);
+static int     check_pair(worker *state, roman_ctx **contexts, int value1,
+                          int value2);
+static double  seconds_since(const struct timespec *start);
+
+int main(int argc, char **argv)
+{
+    const char *mode_names[] = {"malloc", "roman_ctx"};
+
+    int maximum_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double single_thread_rate;
+    double rate;
+    double elapsed;
+    unsigned long operations;
+    unsigned long failures;
+    unsigned long total_failures = 0;
+
+    int mode;
+    int threads;
+
+    bound = (argc > 1) ? atoi(argv[1]) : DEFAULT_BOUND;
+    if (argc > 2) maximum_threads = atoi(argv[2]);
+    if (bound < 1 || maximum_threads < 1) {
+        fprintf(stderr, "usage: %s [bound [maximum threads]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    numerals = create_numerals(bound);
+    if (!numerals) {
+        fprintf(stderr, "could not build numerals up to %d\n", bound);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-10s %8s %12s %10s %12s %8s\n", "interface", "threads",
+           "operations", "seconds", "Mops/s", "scaling");
+    for (mode = USE_MALLOC; mode <= USE_CONTEXT; mode++) {
+        single_thread_rate = 0;
+        for (threads = 1; threads <= maximum_threads;
+             threads = (threads < maximum_threads
+                        && threads * 2 > maximum_threads)
+                       ? maximum_threads : threads * 2) {
+            elapsed = run_workers((allocation_mode)mode, threads,
+                                  &operations, &failures);
+            rate = operations / elapsed;
+            if (threads == 1) single_thread_rate = rate;
+            total_failures += failures;
+
+            printf("%-10s %8d %12lu %10.3f %12.2f %7.2fx\n",
+                   mode_names[mode], threads, operations, elapsed,
+                   rate / 1e6, rate / single_thread_rate);
+        }
+    }
+
+    if (total_failures > 0) {
+        fprintf(stderr, "%lu calculations gave wrong results\n",
+                total_failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * numerals[n] is the numeral for n, built by repeatedly adding "I" so that
+ * the calculator's own single-threaded results serve as the reference.
+ */
+static char **create_numerals(int count)
+{
+    char **result = calloc(count + 1, sizeof(char *));
+
+    int value;
+
+    if (!result) return NULL;
+    result[1] = malloc(sizeof("I"));
+    if (!result[1]) return NULL;
+    strcpy(result[1], "I");
+    for (value = 2; value <= count; value++) {
+        result[value] = add_roman_numerals(result[value - 1], "I");
+        if (!result[value]) return NULL;
+    }
+    return result;
+}
+
+static double run_workers(allocation_mode mode, int number_of_threads,
+                          unsigned long *operations, unsigned long *failures)
+{
+    pthread_t *threads = malloc(number_of_threads * sizeof(pthread_t));
+    worker *workers = malloc(number_of_threads * sizeof(worker));
+    struct timespec start;
+    double elapsed;
+
+    int current;
+
+    if (!threads || !workers) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (current = 0; current < number_of_threads; current++) {
+        workers[current].mode = mode;
+        workers[current].first = current + 1;
+        workers[current].stride = number_of_threads;
+        workers[current].operations = 0;
+        workers[current].failures = 0;
+        if (pthread_create(&threads[current], NULL, run_worker,
+                           &workers[current]) != 0) {
+            fprintf(stderr, "could not start thread %d\n", current);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    *operations = 0;
+    *failures = 0;
+    for (current = 0; current < number_of_threads; current++) {
+        pthread_join(threads[current], NULL);
+        *operations += workers[current].operations;
+        *failures += workers[current].failures;
+    }
+    elapsed = seconds_since(&start);
+
+    free(threads);
+    free(workers);
+    return elapsed;
+}
+
+/** Checks every pair whose first value is in the worker's share. */
+static void *run_worker(void *argument)
+{
+    worker *state = argument;
+    roman_ctx *contexts[2] = {NULL, NULL};
+
+    int value1;
+    int value2;
+
+    if (state->mode == USE_CONTEXT) {
+        contexts[0] = roman_ctx_create();
+        contexts[1] = roman_ctx_create();
+    }
+
+    if (state->mode != USE_CONTEXT || (contexts[0] && contexts[1])) {
+        for (value1 = state->first; value1 <= bound;
+             value1 += state->stride) {
+            for (value2 = 1; value2 <= bound; value2++) {
+                if (!check_pair(state, contexts, value1, value2)) {
+                    state->failures++;
+                }
+            }
+        }
+    } else {
+        state->failures++;
+    }
+
+    roman_ctx_destroy(contexts[0]);
+    roman_ctx_destroy(contexts[1]);
+    return NULL;
+}
+
+/**
+ * Adds the pair and subtracts the second value back out of the sum, which
+ * must give the first value again. The sum is kept in the first context while
+ * the difference is written to the second.
+ */
+static int check_pair(worker *state, roman_ctx **contexts, int value1,
+                      int value2)
+{
+    const char *sum;
+    const char *difference;
+    char *allocated_sum;
+    char *allocated_difference;
+    int correct;
+
+    state->operations += 2;
+    if (state->mode == USE_CONTEXT) {
+        if (roman_ctx_add(contexts[0], numerals[value1], numerals[value2],
+                          &sum) != ROMAN_OK
+            || roman_ctx_subtract(contexts[1], sum, numerals[value2],
+                                  &difference) != ROMAN_OK) {
+            return 0;
+        }
+        return strcmp(difference, numerals[value1]) == 0;
+    }
+
+    allocated_sum = add_roman_numerals(numerals[value1], numerals[value2]);
+    if (!allocated_sum) return 0;
+    allocated_difference = subtract_roman_numerals(allocated_sum,
+                                                   numerals[value2]);
+    correct = allocated_difference
+              && strcmp(allocated_difference, numerals[value1]) == 0;
+
+    free(allocated_sum);
+    free(allocated_difference);
+    return correct;
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec)
+           + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,289 @@
+/* roman_bulk.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roman_calculator_internal.h"
+
+/*
+ * The input is cut into chunks at line boundaries. Worker threads claim the
+ * chunks in order, evaluate each one into a buffer of their own and then wait
+ * for their turn to hand it to the write function, so results come out in
+ * input order while writing is the only thing done one thread at a time.
+ * Each worker holds at most one chunk's results, which keeps memory use
+ * independent of the size of the input.
+ */
+#define MINIMUM_CHUNK_SIZE (64 * 1024)
+#define MAXIMUM_CHUNK_SIZE (4 * 1024 * 1024)
+#define CHUNKS_PER_THREAD 4
+
+typedef struct {
+    const char *input;
+    size_t length;
+    size_t chunk_size;
+    size_t number_of_chunks;
+
+    roman_write_function write;
+    void *write_context;
+
+    pthread_mutex_t lock;
+    pthread_cond_t turn_changed;
+    size_t next_chunk_to_claim;
+    size_t next_chunk_to_write;
+    roman_status status;
+} bulk_job;
+
+typedef struct {
+    bulk_job *job;
+    roman_ctx *ctx;
+    char *output;
+    size_t output_used;
+    size_t output_capacity;
+    roman_line_totals totals;
+} bulk_worker;
+
+static void *run_bulk_worker(void *argument);
+static const char *chunk_boundary(const bulk_job *job, size_t chunk);
+static int   evaluate_chunk(bulk_worker *worker, const char *start,
+                            const char *end);
+static int   evaluate_line_into_output(bulk_worker *worker, const char *line,
+                                       size_t length);
+static int   append_to_output(bulk_worker *worker, const char *bytes,
+                              size_t length);
+static void  hand_over_output(bulk_worker *worker, size_t chunk,
+                              roman_status status);
+
+/*
+ * Evaluating many lines at once
+ */
+
+roman_status roman_evaluate_lines(const char *input, size_t length,
+                                  int number_of_threads,
+                                  roman_write_function write, void *context,
+                                  roman_line_totals *totals)
+{
+    bulk_job job;
+    bulk_worker *workers;
+    pthread_t *threads;
+    int threads_started = 0;
+
+    int current;
+
+    if (totals) memset(totals, 0, sizeof(roman_line_totals));
+    if (length == 0) return ROMAN_OK;
+    if (number_of_threads < 1) number_of_threads = 1;
+
+    job.input = input;
+    job.length = length;
+    job.chunk_size = length / ((size_t)number_of_threads * CHUNKS_PER_THREAD)
+                     + 1;
+    if (job.chunk_size < MINIMUM_CHUNK_SIZE) {
+        job.chunk_size = MINIMUM_CHUNK_SIZE;
+    }
+    if (job.chunk_size > MAXIMUM_CHUNK_SIZE) {
+        job.chunk_size = MAXIMUM_CHUNK_SIZE;
+    }
+    job.number_of_chunks = (length + job.chunk_size - 1) / job.chunk_size;
+    job.write = write;
+    job.write_context = context;
+    job.next_chunk_to_claim = 0;
+    job.next_chunk_to_write = 0;
+    job.status = ROMAN_OK;
+
+    if ((size_t)number_of_threads > job.number_of_chunks) {
+        number_of_threads = (int)job.number_of_chunks;
+    }
+
+    workers = roman_allocate_zeroed(number_of_threads, sizeof(bulk_worker));
+    threads = roman_allocate_zeroed(number_of_threads, sizeof(pthread_t));
+    if (!workers || !threads) {
+        roman_free(workers);
+        roman_free(threads);
+        return ROMAN_ERR_OUT_OF_MEMORY;
+    }
+    for (current = 0; current < number_of_threads; current++) {
+        workers[current].job = &job;
+        workers[current].ctx = roman_ctx_create();
+        if (!workers[current].ctx) job.status = ROMAN_ERR_OUT_OF_MEMORY;
+    }
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn_changed, NULL);
+
+    /*
+     * The calling thread is the first worker; if a thread cannot be started,
+     * the chunks are simply shared among fewer workers.
+     */
+    if (job.status == ROMAN_OK) {
+        for (current = 1; current < number_of_threads; current++) {
+            if (pthread_create(&threads[current], NULL, run_bulk_worker,
+                               &workers[current]) != 0) {
+                break;
+            }
+            threads_started++;
+        }
+        run_bulk_worker(&workers[0]);
+    }
+
+    for (current = 1; current <= threads_started; current++) {
+        pthread_join(threads[current], NULL);
+    }
+
+    for (current = 0; current < number_of_threads; current++) {
+        if (totals) {
+            totals->lines += workers[current].totals.lines;
+            totals->errors += workers[current].totals.errors;
+        }
+        roman_ctx_destroy(workers[current].ctx);
+        roman_free(workers[current].output);
+    }
+
+    pthread_cond_destroy(&job.turn_changed);
+    pthread_mutex_destroy(&job.lock);
+    roman_free(workers);
+    roman_free(threads);
+    return job.status;
+}
+
+/*
+ * Helpers for workers
+ */
+
+/** Claims and evaluates chunks until there are none left. */
+static void *run_bulk_worker(void *argument)
+{
+    bulk_worker *worker = argument;
+    bulk_job *job = worker->job;
+    size_t chunk;
+    roman_status status;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        chunk = job->next_chunk_to_claim;
+        if (chunk < job->number_of_chunks && job->status == ROMAN_OK) {
+            job->next_chunk_to_claim++;
+        } else {
+            chunk = job->number_of_chunks;
+        }
+        pthread_mutex_unlock(&job->lock);
+        if (chunk == job->number_of_chunks) break;
+
+        worker->output_used = 0;
+        status = evaluate_chunk(worker, chunk_boundary(job, chunk),
+                                chunk_boundary(job, chunk + 1))
+                 ? ROMAN_OK : ROMAN_ERR_OUT_OF_MEMORY;
+        hand_over_output(worker, chunk, status);
+    }
+    return NULL;
+}
+
+/**
+ * Chunks begin just after the first newline at or past their nominal start,
+ * so that every line belongs to exactly one chunk.
+ */
+static const char *chunk_boundary(const bulk_job *job, size_t chunk)
+{
+    const char *end = job->input + job->length;
+    const char *nominal_start;
+    const char *newline;
+
+    if (chunk == 0) return job->input;
+    if (chunk >= job->number_of_chunks) return end;
+
+    nominal_start = job->input + chunk * job->chunk_size - 1;
+    newline = memchr(nominal_start, '\n', end - nominal_start);
+    return (newline) ? newline + 1 : end;
+}
+
+static int evaluate_chunk(bulk_worker *worker, const char *start,
+                          const char *end)
+{
+    const char *newline;
+
+    while (start < end) {
+        newline = memchr(start, '\n', end - start);
+        if (!newline) newline = end;
+
+        if (!evaluate_line_into_output(worker, start, newline - start)) {
+            return 0;
+        }
+        start = newline + 1;
+    }
+    return 1;
+}
+
+static int evaluate_line_into_output(bulk_worker *worker, const char *line,
+                                     size_t length)
+{
+    const char *result;
+    roman_status status;
+
+    worker->totals.lines++;
+    status = roman_ctx_evaluate(worker->ctx, line, length, &result);
+    if (status != ROMAN_OK) {
+        worker->totals.errors++;
+        return append_to_output(worker, "error: ", strlen("error: "))
+               && append_to_output(worker, roman_status_message(status),
+                                   strlen(roman_status_message(status)))
+               && append_to_output(worker, "\n", 1);
+    }
+    return append_to_output(worker, result, strlen(result))
+           && append_to_output(worker, "\n", 1);
+}
+
+static int append_to_output(bulk_worker *worker, const char *bytes,
+                            size_t length)
+{
+    size_t new_capacity;
+    char *new_output;
+
+    if (worker->output_used + length > worker->output_capacity) {
+        new_capacity = worker->output_capacity * 2;
+        if (new_capacity < worker->output_used + length) {
+            new_capacity = worker->output_used + length + MINIMUM_CHUNK_SIZE;
+        }
+        new_output = roman_reallocate(worker->output, new_capacity);
+        if (!new_output) return 0;
+
+        worker->output = new_output;
+        worker->output_capacity = new_capacity;
+    }
+
+    memcpy(worker->output + worker->output_used, bytes, length);
+    worker->output_used += length;
+    return 1;
+}
+
+/**
+ * Wait until every earlier chunk has been written, then write this one. Once
+ * anything has failed, later chunks are skipped but still take their turn so
+ * that no worker waits forever.
+ */
+static void hand_over_output(bulk_worker *worker, size_t chunk,
+                             roman_status status)
+{
+    bulk_job *job = worker->job;
+
+    pthread_mutex_lock(&job->lock);
+    while (job->next_chunk_to_write != chunk) {
+        pthread_cond_wait(&job->turn_changed, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    /* Only the worker whose turn it is gets here, so it can write unlocked. */
+    if (status == ROMAN_OK && job->status == ROMAN_OK
+        && worker->output_used > 0
+        && job->write(job->write_context, worker->output,
+                      worker->output_used) != 0) {
+        status = ROMAN_ERR_WRITE_FAILED;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    if (job->status == ROMAN_OK) job->status = status;
+    job->next_chunk_to_write++;
+    pthread_cond_broadcast(&job->turn_changed);
+    pthread_mutex_unlock(&job->lock);
+}
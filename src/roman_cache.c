@@ -0,0 +1,449 @@
+/* roman_cache.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roman_calculator_internal.h"
+
+/*
+ * The cache is split into shards, each a set-associative table behind a
+ * mutex of its own, so threads working on different pairs rarely wait for one
+ * another. A pair hashes to one shard and to one set of CACHE_WAYS slots in
+ * it; when the set is full, its least recently used slot is replaced. A set
+ * keeps the hashes of its keys together, so a lookup reads one cache line to
+ * find the only slot worth comparing, and short keys are kept in the slot
+ * itself rather than behind another pointer.
+ *
+ * Results are shared: each lives in a cached_result that counts the cache
+ * itself and every caller still holding it, and is freed by whichever of them
+ * lets go of it last. Failed calculations are cached too (with no text), so a
+ * popular malformed pair is not re-parsed either.
+ */
+#define NUMBER_OF_SHARDS 16
+#define CACHE_WAYS 4
+#define INLINE_KEY_SIZE 32
+#define RESULT_BUFFER_SIZE 64
+
+typedef enum { CACHED_ADD, CACHED_SUBTRACT } cached_operation;
+
+typedef struct {
+    int references;
+    char text[1];
+} cached_result;
+
+/* A pair as it is looked up: the key is only stored for a new entry. */
+typedef struct {
+    cached_operation operation;
+    const char *numeral1;
+    const char *numeral2;
+    size_t length1;
+    size_t length2;
+    uint64_t hash;
+} cache_lookup;
+
+/*
+ * Keys are the operation, then both numerals back to back, the first of them
+ * length1 bytes long. key points to inline_key unless the key is longer than
+ * INLINE_KEY_SIZE.
+ */
+typedef struct {
+    char *key;
+    size_t key_length;
+    size_t length1;
+    roman_status status;
+    cached_result *result;
+    uint64_t last_used;
+    char inline_key[INLINE_KEY_SIZE];
+} cache_slot;
+
+/* A hash of 0 marks an empty slot; prepare_lookup never produces it. */
+typedef struct {
+    uint64_t hashes[CACHE_WAYS];
+    cache_slot slots[CACHE_WAYS];
+} cache_set;
+
+typedef struct {
+    pthread_mutex_t lock;
+    cache_set *sets;
+    uint64_t clock;
+    roman_cache_stats stats;
+} cache_shard;
+
+struct roman_cache {
+    size_t sets_per_shard;
+    cache_shard shards[NUMBER_OF_SHARDS];
+};
+
+static roman_status cached_calculation(roman_cache *cache,
+                                       cached_operation operation,
+                                       const char *numeral1, size_t length1,
+                                       const char *numeral2, size_t length2,
+                                       const char **result);
+static void           prepare_lookup(cache_lookup *lookup,
+                                     cached_operation operation,
+                                     const char *numeral1, size_t length1,
+                                     const char *numeral2, size_t length2);
+static uint64_t       hash_bytes(uint64_t hash, const char *bytes,
+                                 size_t length);
+static int            find_way(cache_shard *shard, cache_set *set,
+                               const cache_lookup *lookup);
+static int            choose_victim(const cache_set *set);
+static int            fill_slot(cache_set *set, int way,
+                                const cache_lookup *lookup,
+                                roman_status status, cached_result *result);
+static cached_result *calculate_result(const cache_lookup *lookup,
+                                       roman_status *status);
+static const char    *share_result(cache_slot *slot);
+static void           release_result(cached_result *result);
+static void           empty_way(cache_set *set, int way);
+
+/*
+ * Creating and destroying caches
+ */
+
+roman_cache *roman_cache_create(size_t capacity)
+{
+    roman_cache *cache = roman_allocate(sizeof(roman_cache));
+
+    int shard;
+
+    if (!cache) return NULL;
+
+    cache->sets_per_shard = capacity / (NUMBER_OF_SHARDS * CACHE_WAYS);
+    if (cache->sets_per_shard == 0) cache->sets_per_shard = 1;
+
+    for (shard = 0; shard < NUMBER_OF_SHARDS; shard++) {
+        cache->shards[shard].sets
+            = roman_allocate_zeroed(cache->sets_per_shard, sizeof(cache_set));
+        if (!cache->shards[shard].sets) {
+            while (shard-- > 0) {
+                pthread_mutex_destroy(&cache->shards[shard].lock);
+                roman_free(cache->shards[shard].sets);
+            }
+            roman_free(cache);
+            return NULL;
+        }
+        pthread_mutex_init(&cache->shards[shard].lock, NULL);
+        cache->shards[shard].clock = 0;
+        memset(&cache->shards[shard].stats, 0, sizeof(roman_cache_stats));
+    }
+    return cache;
+}
+
+/** Results still held by callers stay valid until they are released. */
+void roman_cache_destroy(roman_cache *cache)
+{
+    int shard;
+    size_t set;
+    int way;
+
+    if (!cache) return;
+
+    for (shard = 0; shard < NUMBER_OF_SHARDS; shard++) {
+        for (set = 0; set < cache->sets_per_shard; set++) {
+            for (way = 0; way < CACHE_WAYS; way++) {
+                empty_way(&cache->shards[shard].sets[set], way);
+            }
+        }
+        pthread_mutex_destroy(&cache->shards[shard].lock);
+        roman_free(cache->shards[shard].sets);
+    }
+    roman_free(cache);
+}
+
+/*
+ * Cached arithmetic
+ */
+
+roman_status roman_cache_add(roman_cache *cache, const char *summand1,
+                             const char *summand2, const char **sum)
+{
+    return cached_calculation(cache, CACHED_ADD, summand1, strlen(summand1),
+                              summand2, strlen(summand2), sum);
+}
+
+roman_status roman_cache_subtract(roman_cache *cache, const char *numeral1,
+                                  const char *numeral2,
+                                  const char **difference)
+{
+    return cached_calculation(cache, CACHED_SUBTRACT, numeral1,
+                              strlen(numeral1), numeral2, strlen(numeral2),
+                              difference);
+}
+
+roman_status roman_cache_add_n(roman_cache *cache, const char *summand1,
+                               size_t length1, const char *summand2,
+                               size_t length2, const char **sum)
+{
+    return cached_calculation(cache, CACHED_ADD, summand1, length1, summand2,
+                              length2, sum);
+}
+
+roman_status roman_cache_subtract_n(roman_cache *cache, const char *numeral1,
+                                    size_t length1, const char *numeral2,
+                                    size_t length2, const char **difference)
+{
+    return cached_calculation(cache, CACHED_SUBTRACT, numeral1, length1,
+                              numeral2, length2, difference);
+}
+
+void roman_cache_release(const char *result)
+{
+    if (!result) return;
+    release_result((cached_result *)(result
+                                      - offsetof(cached_result, text)));
+}
+
+void roman_cache_get_stats(roman_cache *cache, roman_cache_stats *stats)
+{
+    int shard;
+
+    memset(stats, 0, sizeof(roman_cache_stats));
+    for (shard = 0; shard < NUMBER_OF_SHARDS; shard++) {
+        pthread_mutex_lock(&cache->shards[shard].lock);
+        stats->hits += cache->shards[shard].stats.hits;
+        stats->misses += cache->shards[shard].stats.misses;
+        stats->evictions += cache->shards[shard].stats.evictions;
+        pthread_mutex_unlock(&cache->shards[shard].lock);
+    }
+}
+
+/**
+ * Look the pair up and, on a miss, calculate it without holding the shard's
+ * lock, so a slow calculation never holds up hits on the same shard. Should
+ * another thread insert the same pair in the meantime, its entry is kept.
+ */
+static roman_status cached_calculation(roman_cache *cache,
+                                       cached_operation operation,
+                                       const char *numeral1, size_t length1,
+                                       const char *numeral2, size_t length2,
+                                       const char **result)
+{
+    cache_lookup lookup;
+    cache_shard *shard;
+    cache_set *set;
+    cached_result *calculated;
+    roman_status status;
+    int way;
+
+    *result = NULL;
+    prepare_lookup(&lookup, operation, numeral1, length1, numeral2, length2);
+    shard = &cache->shards[lookup.hash % NUMBER_OF_SHARDS];
+    set = &shard->sets[(lookup.hash / NUMBER_OF_SHARDS)
+                       % cache->sets_per_shard];
+
+    pthread_mutex_lock(&shard->lock);
+    way = find_way(shard, set, &lookup);
+    if (way >= 0) {
+        shard->stats.hits++;
+        status = set->slots[way].status;
+        *result = share_result(&set->slots[way]);
+        pthread_mutex_unlock(&shard->lock);
+        return status;
+    }
+    shard->stats.misses++;
+    pthread_mutex_unlock(&shard->lock);
+
+    calculated = calculate_result(&lookup, &status);
+    if (status == ROMAN_ERR_OUT_OF_MEMORY) return status;
+
+    pthread_mutex_lock(&shard->lock);
+    way = find_way(shard, set, &lookup);
+    if (way >= 0) {
+        if (calculated) release_result(calculated);
+    } else {
+        way = choose_victim(set);
+        if (set->hashes[way] != 0) {
+            shard->stats.evictions++;
+            empty_way(set, way);
+        }
+        if (!fill_slot(set, way, &lookup, status, calculated)) {
+            pthread_mutex_unlock(&shard->lock);
+            if (calculated) release_result(calculated);
+            return ROMAN_ERR_OUT_OF_MEMORY;
+        }
+        set->slots[way].last_used = ++shard->clock;
+    }
+    status = set->slots[way].status;
+    *result = share_result(&set->slots[way]);
+    pthread_mutex_unlock(&shard->lock);
+    return status;
+}
+
+/*
+ * Helpers for looking up and storing results
+ */
+
+static void prepare_lookup(cache_lookup *lookup, cached_operation operation,
+                           const char *numeral1, size_t length1,
+                           const char *numeral2, size_t length2)
+{
+    lookup->operation = operation;
+    lookup->numeral1 = numeral1;
+    lookup->numeral2 = numeral2;
+    lookup->length1 = length1;
+    lookup->length2 = length2;
+
+    lookup->hash = hash_bytes(0x9E3779B97F4A7C15ULL * (operation + 1),
+                              numeral1, lookup->length1);
+    lookup->hash = hash_bytes(lookup->hash ^ lookup->length1, numeral2,
+                              lookup->length2);
+    lookup->hash ^= lookup->hash >> 29;
+    if (lookup->hash == 0) lookup->hash = 1;
+}
+
+/**
+ * Mixes in eight bytes at a time, which matters because hashing is most of
+ * the work of a hit. The length of the first numeral is mixed in between the
+ * two, so moving characters from one numeral to the other changes the hash.
+ */
+static uint64_t hash_bytes(uint64_t hash, const char *bytes, size_t length)
+{
+    uint64_t word;
+
+    while (length > 0) {
+        word = 0;
+        memcpy(&word, bytes, (length < 8) ? length : 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+
+        if (length < 8) break;
+        bytes += 8;
+        length -= 8;
+    }
+    return hash;
+}
+
+/** Returns the way holding the pair, or -1. */
+static int find_way(cache_shard *shard, cache_set *set,
+                    const cache_lookup *lookup)
+{
+    const cache_slot *slot;
+
+    int way;
+    for (way = 0; way < CACHE_WAYS; way++) {
+        if (set->hashes[way] != lookup->hash) continue;
+
+        slot = &set->slots[way];
+        if (slot->key_length == 1 + lookup->length1 + lookup->length2
+            && slot->length1 == lookup->length1
+            && slot->key[0] == (char)lookup->operation
+            && memcmp(slot->key + 1, lookup->numeral1, lookup->length1) == 0
+            && memcmp(slot->key + 1 + lookup->length1, lookup->numeral2,
+                      lookup->length2) == 0) {
+            set->slots[way].last_used = ++shard->clock;
+            return way;
+        }
+    }
+    return -1;
+}
+
+/** An empty way if there is one, otherwise the least recently used. */
+static int choose_victim(const cache_set *set)
+{
+    int victim = 0;
+
+    int way;
+    for (way = 0; way < CACHE_WAYS; way++) {
+        if (set->hashes[way] == 0) return way;
+        if (set->slots[way].last_used < set->slots[victim].last_used) {
+            victim = way;
+        }
+    }
+    return victim;
+}
+
+/** Store a new entry in an empty way; returns 0 if out of memory. */
+static int fill_slot(cache_set *set, int way, const cache_lookup *lookup,
+                     roman_status status, cached_result *result)
+{
+    cache_slot *slot = &set->slots[way];
+    size_t key_length = 1 + lookup->length1 + lookup->length2;
+
+    slot->key = (key_length <= INLINE_KEY_SIZE) ? slot->inline_key
+                                                : roman_allocate(key_length);
+    if (!slot->key) return 0;
+
+    slot->key[0] = (char)lookup->operation;
+    memcpy(slot->key + 1, lookup->numeral1, lookup->length1);
+    memcpy(slot->key + 1 + lookup->length1, lookup->numeral2,
+           lookup->length2);
+    slot->key_length = key_length;
+    slot->length1 = lookup->length1;
+    slot->status = status;
+    slot->result = result;
+    set->hashes[way] = lookup->hash;
+    return 1;
+}
+
+/**
+ * Calculate a result straight into a cached_result, going through a buffer on
+ * the stack unless the result is too long for it. Returns NULL (and the
+ * reason in status) if the pair cannot be calculated.
+ */
+static cached_result *calculate_result(const cache_lookup *lookup,
+                                       roman_status *status)
+{
+    char buffer[RESULT_BUFFER_SIZE];
+    char *text = buffer;
+    size_t length;
+    cached_result *result;
+
+    length = (lookup->operation == CACHED_ADD)
+             ? add_roman_numerals_into_n(lookup->numeral1, lookup->length1,
+                                         lookup->numeral2, lookup->length2,
+                                         buffer, sizeof(buffer), status)
+             : subtract_roman_numerals_into_n(lookup->numeral1,
+                                              lookup->length1,
+                                              lookup->numeral2,
+                                              lookup->length2, buffer,
+                                              sizeof(buffer), status);
+    if (*status != ROMAN_OK) return NULL;
+
+    if (length >= sizeof(buffer)) {
+        *status = (lookup->operation == CACHED_ADD)
+                  ? roman_add_n(lookup->numeral1, lookup->length1,
+                                lookup->numeral2, lookup->length2, &text)
+                  : roman_subtract_n(lookup->numeral1, lookup->length1,
+                                     lookup->numeral2, lookup->length2,
+                                     &text);
+        if (*status != ROMAN_OK) return NULL;
+    }
+
+    result = roman_allocate(sizeof(cached_result) + length);
+    if (result) {
+        result->references = 1;
+        memcpy(result->text, text, length + 1);
+    } else {
+        *status = ROMAN_ERR_OUT_OF_MEMORY;
+    }
+    if (text != buffer) roman_free(text);
+    return result;
+}
+
+/** Called with the shard's lock held. */
+static const char *share_result(cache_slot *slot)
+{
+    if (!slot->result) return NULL;
+    __sync_add_and_fetch(&slot->result->references, 1);
+    return slot->result->text;
+}
+
+static void release_result(cached_result *result)
+{
+    if (__sync_sub_and_fetch(&result->references, 1) == 0) roman_free(result);
+}
+
+static void empty_way(cache_set *set, int way)
+{
+    cache_slot *slot = &set->slots[way];
+
+    if (set->hashes[way] == 0) return;
+    if (slot->result) release_result(slot->result);
+    if (slot->key != slot->inline_key) roman_free(slot->key);
+    memset(slot, 0, sizeof(cache_slot));
+    set->hashes[way] = 0;
+}
@@ -1,153 +1,1930 @@
 /* roman_calculator.c */
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "roman_calculator_internal.h"
+
 static const char roman_characters[7] = {'I', 'V', 'X', 'L', 'C', 'D', 'M'};
 typedef enum {
     RCI_I, RCI_V, RCI_X, RCI_L, RCI_C, RCI_D, RCI_M, RCI_END
 } rc_index;
 
-/* Input validation */
-static void  validate_input_strings(const char *input1, const char *input2);
+/* The rc_index of every byte, or RCI_END if it is not a Roman character */
+#define NR RCI_END
+static const unsigned char roman_character_indices[256] = {
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0x00 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0x10 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0x20 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0x30 */
+    /*  @   A   B      C      D   E   F   G   H      I   J   K      L      M */
+    NR, NR, NR, RCI_C, RCI_D, NR, NR, NR, NR, RCI_I, NR, NR, RCI_L, RCI_M,
+    NR, NR,                                                         /* 0x40 */
+    /*  P   Q   R   S   T   U      V   W      X */
+    NR, NR, NR, NR, NR, NR, RCI_V, NR, RCI_X, NR, NR, NR, NR, NR, NR, NR,
+                                                                    /* 0x50 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0x60 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0x70 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0x80 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0x90 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0xA0 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0xB0 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0xC0 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0xD0 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, /* 0xE0 */
+    NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR, NR  /* 0xF0 */
+};
+#undef NR
+
+/*
+ * The canonical numeral for every value below 1000, generated at build time
+ * by tools/generate_canonical_numerals.c. Results are rendered as a run of
+ * 'M' characters followed by one of these.
+ */
+typedef struct {
+    unsigned char length;
+    char numeral[15];
+} canonical_numeral;
+
+static const canonical_numeral canonical_numerals[1000] = {
+#include "canonical_numerals.inc"
+};
+
+/* The values of the Roman characters, in rc_index order */
+static const uint64_t roman_character_values[8] = {
+    1, 5, 10, 50, 100, 500, 1000, 0
+};
+
+/*
+ * The states of the strict validator: what the numeral read so far ends with,
+ * one state per partial or complete digit below the thousands.
+ */
+typedef enum {
+    CS_START, CS_THOUSANDS,
+    CS_C, CS_CC, CS_CCC, CS_D, CS_DC, CS_DCC, CS_DCCC, CS_CD_CM,
+    CS_X, CS_XX, CS_XXX, CS_L, CS_LX, CS_LXX, CS_LXXX, CS_XL_XC,
+    CS_I, CS_II, CS_III, CS_V, CS_VI, CS_VII, CS_VIII, CS_IV_IX,
+    CS_REJECT
+} canonical_state;
+
+/*
+ * The transitions of a DFA accepting exactly the canonical numerals, that is
+ * M* (CM|CD|D?C{0,3}) (XC|XL|L?X{0,3}) (IX|IV|V?I{0,3}), indexed by state and
+ * by the rc_index of the next character (columns I, V, X, L, C, D and M).
+ * Every state but CS_START accepts.
+ */
+#define NO CS_REJECT
+static const unsigned char canonical_transitions[CS_REJECT][7] = {
+    /* START, THOUSANDS */
+    {CS_I,    CS_V,     CS_X,     CS_L,     CS_C,     CS_D,     CS_THOUSANDS},
+    {CS_I,    CS_V,     CS_X,     CS_L,     CS_C,     CS_D,     CS_THOUSANDS},
+    /* Hundreds: C, CC, CCC, D, DC, DCC, DCCC, and CD or CM */
+    {CS_I,    CS_V,     CS_X,     CS_L,     CS_CC,    CS_CD_CM, CS_CD_CM},
+    {CS_I,    CS_V,     CS_X,     CS_L,     CS_CCC,   NO,       NO},
+    {CS_I,    CS_V,     CS_X,     CS_L,     NO,       NO,       NO},
+    {CS_I,    CS_V,     CS_X,     CS_L,     CS_DC,    NO,       NO},
+    {CS_I,    CS_V,     CS_X,     CS_L,     CS_DCC,   NO,       NO},
+    {CS_I,    CS_V,     CS_X,     CS_L,     CS_DCCC,  NO,       NO},
+    {CS_I,    CS_V,     CS_X,     CS_L,     NO,       NO,       NO},
+    {CS_I,    CS_V,     CS_X,     CS_L,     NO,       NO,       NO},
+    /* Tens: X, XX, XXX, L, LX, LXX, LXXX, and XL or XC */
+    {CS_I,    CS_V,     CS_XX,    CS_XL_XC, CS_XL_XC, NO,       NO},
+    {CS_I,    CS_V,     CS_XXX,   NO,       NO,       NO,       NO},
+    {CS_I,    CS_V,     NO,       NO,       NO,       NO,       NO},
+    {CS_I,    CS_V,     CS_LX,    NO,       NO,       NO,       NO},
+    {CS_I,    CS_V,     CS_LXX,   NO,       NO,       NO,       NO},
+    {CS_I,    CS_V,     CS_LXXX,  NO,       NO,       NO,       NO},
+    {CS_I,    CS_V,     NO,       NO,       NO,       NO,       NO},
+    {CS_I,    CS_V,     NO,       NO,       NO,       NO,       NO},
+    /* Units: I, II, III, V, VI, VII, VIII, and IV or IX */
+    {CS_II,   CS_IV_IX, CS_IV_IX, NO,       NO,       NO,       NO},
+    {CS_III,  NO,       NO,       NO,       NO,       NO,       NO},
+    {NO,      NO,       NO,       NO,       NO,       NO,       NO},
+    {CS_VI,   NO,       NO,       NO,       NO,       NO,       NO},
+    {CS_VII,  NO,       NO,       NO,       NO,       NO,       NO},
+    {CS_VIII, NO,       NO,       NO,       NO,       NO,       NO},
+    {NO,      NO,       NO,       NO,       NO,       NO,       NO},
+    {NO,      NO,       NO,       NO,       NO,       NO,       NO}
+};
+#undef NO
+
+/*
+ * Each character adds at most 9 to a character count once carryovers are
+ * taken into account, so longer inputs could overflow our int counts.
+ */
+#define MAXIMUM_NUMERAL_LENGTH (INT_MAX / 20)
+
+/*
+ * Past this many characters, the rest of a numeral is counted with vector
+ * instructions (see roman_simd.c) when they are available.
+ */
+#define VECTORIZED_COUNTING_THRESHOLD 64
+
+/* The stages shared by addition and subtraction, up to rendering */
+typedef roman_status (*character_counts_operation)(const char *numeral1,
+                                                   size_t length1,
+                                                   const char *numeral2,
+                                                   size_t length2,
+                                                   int **character_counts_ptr);
+
+/* Scratch contexts */
+struct roman_ctx {
+    char *buffer;
+    size_t capacity;
+};
+
+static roman_status character_counts_to_context(roman_ctx *ctx,
+                                                const int *character_counts,
+                                                const char **result);
+static int   reserve_context_buffer(char **buffer, size_t *capacity,
+                                    size_t needed);
+static const char *skip_whitespace(const char *start, const char *end);
+static const char *trim_trailing_whitespace(const char *start,
+                                            const char *end);
+
+/* Arenas */
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t capacity;
+    size_t used;
+    char bytes[1];
+} arena_block;
+
+struct roman_arena {
+    arena_block *first;
+    arena_block *current;
+    size_t block_size;
+};
+
+static roman_status character_counts_to_arena(roman_arena *arena,
+                                              const int *character_counts,
+                                              const char **result);
+static char *allocate_from_arena(roman_arena *arena, size_t size);
+static arena_block *create_arena_block(size_t capacity);
+
+/* Batch processing */
+static size_t run_batch(character_counts_operation operation,
+                        const char *const *numerals1,
+                        const char *const *numerals2, size_t count,
+                        char *arena, size_t arena_capacity,
+                        size_t *offsets, roman_status *statuses);
+
+/* Helpers for big numerals */
+static void  big_numeral_to_character_counts(const roman_big *value,
+                                             int **character_counts_ptr);
+static roman_status character_counts_to_big_numeral(
+    int **character_counts_ptr, uint64_t thousands, roman_big *value);
+static int   compare_big_numeral_tails(const roman_big *value1,
+                                       const roman_big *value2);
+
+/* Helpers for accumulators */
+static roman_status accumulate_numeral(roman_acc *acc, const char *numeral,
+                                       size_t length, int sign);
+static int   accumulator_would_overflow(const roman_acc *acc,
+                                        const int *character_counts);
+static void  normalize_accumulator(roman_acc *acc);
+
+/* Helpers for multiplication and division */
+static roman_status count_carried_operands(const char *numeral1,
+                                           size_t length1,
+                                           const char *numeral2,
+                                           size_t length2,
+                                           int **counts1_ptr,
+                                           int **counts2_ptr);
+static roman_status multiply_character_counts(const int *factor1,
+                                              const int *factor2,
+                                              int **product_ptr);
+static void  divide_character_counts(int **remainder_ptr, const int *divisor,
+                                     int **quotient_ptr);
+static int   scale_character_counts(const int *character_counts,
+                                    unsigned exponent, int **scaled_ptr);
+static int   add_character_product(rc_index index1, rc_index index2,
+                                   uint64_t copies, int **character_counts_ptr,
+                                   uint64_t *thousands);
+static int   add_power_of_ten(unsigned five, unsigned exponent,
+                              uint64_t copies, int **character_counts_ptr,
+                              uint64_t *thousands);
+static int   finish_thousands(int **character_counts_ptr, uint64_t thousands);
+static int   compare_character_counts(const int *character_counts1,
+                                      const int *character_counts2);
+
+/* Helpers that directly manipulate a character_counts array */
+static roman_status compute_sum_character_counts(const char *summand1,
+                                                 size_t length1,
+                                                 const char *summand2,
+                                                 size_t length2,
+                                                 int **character_counts_ptr);
+static roman_status compute_difference_character_counts(
+    const char *numeral1, size_t length1, const char *numeral2,
+    size_t length2, int **character_counts_ptr);
+static roman_status count_occurrences_of_roman_characters(
+    const char *roman_numeral, size_t length, int **character_counts_ptr);
+static roman_status validate_canonical_form(const char *roman_numeral,
+                                            size_t length);
+static roman_status decode_column_entry(const unsigned char *entry,
+                                        size_t length, size_t valid_length,
+                                        roman_validation mode,
+                                        uint64_t *value);
+static roman_status sum_roman_characters(const unsigned char *numeral,
+                                         size_t length, uint64_t *value);
+static int          is_canonical_prefix(const unsigned char *numeral,
+                                        size_t length);
+static size_t       count_leading_thousands(const unsigned char *numeral,
+                                            size_t length);
+static roman_status count_remaining_characters_vectorized(
+    size_t length_so_far, const char *remainder, size_t remaining_length,
+    int **character_counts_ptr);
+static void  add_tally_to_character_counts(const roman_character_tally *tally,
+                                           int **character_counts_ptr);
+static void  compute_carryovers(int **symbol_counts_ptr);
+static void  borrow_to_remove_negative_character_counts(int **character_counts);
+static void  replace_larger_numeral_with_smaller(int **character_counts_ptr,
+                                                 rc_index larger,
+                                                 rc_index smaller,
+                                                 int number_to_replace);
+static void  subtractive_form_to_character_counts(rc_index index1,
+                                                  rc_index index2,
+                                                  int **character_counts_ptr);
+
+/* Helpers for building result strings */
+static char *character_counts_to_string(const int *character_counts);
+static size_t character_counts_to_buffer(const int *character_counts,
+                                         char *out, size_t capacity);
+static size_t rendered_length_of_character_counts(const int *character_counts);
+static void  write_character_counts(const int *character_counts,
+                                     char *location);
+static int   value_below_one_thousand(const int *character_counts);
+static int   relative_roman_character_value(char old_char, char new_char);
+
+/* General purpose predicate functions */
+static int   at_power_of_ten(rc_index index);
+static int   at_subtractive_form(rc_index index1, rc_index index2);
+static int   has_negative_count(const int *character_counts);
+
+/* Helpers for working with roman characters and their enum indices */
+static rc_index get_index(char roman_character);
+static rc_index index_within(const unsigned char *numeral, size_t position,
+                             size_t length);
+static rc_index get_index_of_first_positive_count(rc_index start,
+                                                  int **character_counts_ptr);
+
+/* Helpers for manipulating arrays */
+static void  subtract_arrays(int **array1, int **array2);
+
+/*
+ * Our Roman numeral arithmetic functions
+ */
+
+char *add_roman_numerals(const char *summand1, const char *summand2)
+{
+    char *sum;
+    roman_add(summand1, summand2, &sum);
+    return sum;
+}
+
+char *subtract_roman_numerals(const char *numeral1, const char *numeral2)
+{
+    char *difference;
+    roman_subtract(numeral1, numeral2, &difference);
+    return difference;
+}
+
+roman_status roman_add(const char *summand1, const char *summand2,
+                       char **sum)
+{
+    return roman_add_n(summand1, strlen(summand1), summand2, strlen(summand2),
+                       sum);
+}
+
+roman_status roman_subtract(const char *numeral1, const char *numeral2,
+                            char **difference)
+{
+    return roman_subtract_n(numeral1, strlen(numeral1), numeral2,
+                            strlen(numeral2), difference);
+}
+
+roman_status roman_add_n(const char *summand1, size_t length1,
+                         const char *summand2, size_t length2, char **sum)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
+
+    *sum = NULL;
+    status = compute_sum_character_counts(summand1, length1, summand2,
+                                          length2, &character_counts);
+    if (status != ROMAN_OK) return status;
+
+    *sum = character_counts_to_string(character_counts);
+    return (*sum) ? ROMAN_OK : ROMAN_ERR_OUT_OF_MEMORY;
+}
+
+roman_status roman_subtract_n(const char *numeral1, size_t length1,
+                              const char *numeral2, size_t length2,
+                              char **difference)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
+
+    *difference = NULL;
+    status = compute_difference_character_counts(numeral1, length1, numeral2,
+                                                 length2, &character_counts);
+    if (status != ROMAN_OK) return status;
+
+    *difference = character_counts_to_string(character_counts);
+    return (*difference) ? ROMAN_OK : ROMAN_ERR_OUT_OF_MEMORY;
+}
+
+size_t add_roman_numerals_into(const char *summand1, const char *summand2,
+                               char *out, size_t capacity,
+                               roman_status *status)
+{
+    return add_roman_numerals_into_n(summand1, strlen(summand1), summand2,
+                                     strlen(summand2), out, capacity, status);
+}
+
+size_t subtract_roman_numerals_into(const char *numeral1,
+                                    const char *numeral2,
+                                    char *out, size_t capacity,
+                                    roman_status *status)
+{
+    return subtract_roman_numerals_into_n(numeral1, strlen(numeral1),
+                                          numeral2, strlen(numeral2), out,
+                                          capacity, status);
+}
+
+size_t add_roman_numerals_into_n(const char *summand1, size_t length1,
+                                 const char *summand2, size_t length2,
+                                 char *out, size_t capacity,
+                                 roman_status *status)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status result_status;
+
+    result_status = compute_sum_character_counts(summand1, length1, summand2,
+                                                 length2, &character_counts);
+    if (status) *status = result_status;
+    if (result_status != ROMAN_OK) {
+        if (capacity > 0) out[0] = '\0';
+        return 0;
+    }
+
+    return character_counts_to_buffer(character_counts, out, capacity);
+}
+
+size_t subtract_roman_numerals_into_n(const char *numeral1, size_t length1,
+                                      const char *numeral2, size_t length2,
+                                      char *out, size_t capacity,
+                                      roman_status *status)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status result_status;
+
+    result_status = compute_difference_character_counts(numeral1, length1,
+                                                        numeral2, length2,
+                                                        &character_counts);
+    if (status) *status = result_status;
+    if (result_status != ROMAN_OK) {
+        if (capacity > 0) out[0] = '\0';
+        return 0;
+    }
+
+    return character_counts_to_buffer(character_counts, out, capacity);
+}
+
+roman_status roman_add_length(const char *summand1, const char *summand2,
+                              size_t *length)
+{
+    return roman_add_length_n(summand1, strlen(summand1), summand2,
+                              strlen(summand2), length);
+}
+
+roman_status roman_subtract_length(const char *numeral1, const char *numeral2,
+                                   size_t *length)
+{
+    return roman_subtract_length_n(numeral1, strlen(numeral1), numeral2,
+                                   strlen(numeral2), length);
+}
+
+roman_status roman_add_length_n(const char *summand1, size_t length1,
+                                const char *summand2, size_t length2,
+                                size_t *length)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
+
+    *length = 0;
+    status = compute_sum_character_counts(summand1, length1, summand2,
+                                          length2, &character_counts);
+    if (status != ROMAN_OK) return status;
+
+    *length = rendered_length_of_character_counts(character_counts);
+    return ROMAN_OK;
+}
+
+roman_status roman_subtract_length_n(const char *numeral1, size_t length1,
+                                     const char *numeral2, size_t length2,
+                                     size_t *length)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
+
+    *length = 0;
+    status = compute_difference_character_counts(numeral1, length1, numeral2,
+                                                 length2, &character_counts);
+    if (status != ROMAN_OK) return status;
+
+    *length = rendered_length_of_character_counts(character_counts);
+    return ROMAN_OK;
+}
+
+const char *roman_status_message(roman_status status)
+{
+    switch (status) {
+        case ROMAN_OK: return "success";
+        case ROMAN_ERR_EMPTY_INPUT: return "empty input";
+        case ROMAN_ERR_INVALID_CHARACTER: return "invalid character in input";
+        case ROMAN_ERR_AMBIGUOUS_FORM: return "ambiguous Roman numeral";
+        case ROMAN_ERR_OVERFLOW: return "numeral too long";
+        case ROMAN_ERR_NEGATIVE_RESULT: return "result would be negative";
+        case ROMAN_ERR_OUT_OF_MEMORY: return "out of memory";
+        case ROMAN_ERR_NO_SPACE: return "not enough space for result";
+        case ROMAN_ERR_WRITE_FAILED: return "failed to write result";
+        case ROMAN_ERR_SYNTAX: return "expected \"A + B\" or \"A - B\"";
+        case ROMAN_ERR_NON_CANONICAL: return "numeral not in canonical form";
+        default: return "unknown status";
+    }
+}
+
+/*
+ * Conversion between numerals and integers
+ */
+
+roman_status roman_to_u64(const char *numeral, uint64_t *value)
+{
+    return roman_to_u64_n(numeral, strlen(numeral), value);
+}
+
+roman_status roman_to_u64_n(const char *numeral, size_t length,
+                            uint64_t *value)
+{
+    roman_status status = sum_roman_characters((const unsigned char *)numeral,
+                                               length, value);
+
+    ROMAN_COUNT(validation_failures, status != ROMAN_OK);
+    return status;
+}
+
+/**
+ * Write the canonical numeral for a value (the empty string for zero) as a
+ * run of 'M' characters and one entry of the canonical numeral table. Like
+ * add_roman_numerals_into, returns the length of the full numeral and writes
+ * it only if that is less than capacity.
+ */
+size_t u64_to_roman(uint64_t value, char *out, size_t capacity)
+{
+    const canonical_numeral *tail = &canonical_numerals[value % 1000];
+    uint64_t length = roman_len_for(value);
+
+    if (length < capacity) {
+        memset(out, 'M', (size_t)(value / 1000));
+        memcpy(out + (size_t)(value / 1000), tail->numeral, tail->length + 1);
+        ROMAN_COUNT(bytes_rendered, length);
+    } else if (capacity > 0) {
+        out[0] = '\0';
+    }
+    return (length > SIZE_MAX) ? SIZE_MAX : (size_t)length;
+}
+
+uint64_t roman_len_for(uint64_t value)
+{
+    return value / 1000 + canonical_numerals[value % 1000].length;
+}
+
+/*
+ * Validation
+ */
+
+roman_status roman_validate(const char *numeral, roman_validation mode)
+{
+    return roman_validate_n(numeral, strlen(numeral), mode);
+}
+
+/**
+ * The lenient mode is the arithmetic functions' own decoder, counting into a
+ * scratch array.
+ */
+roman_status roman_validate_n(const char *numeral, size_t length,
+                              roman_validation mode)
+{
+    int character_counts[7] = {0};
+    int *character_counts_ptr = character_counts;
+    roman_status status;
+
+    if (mode == ROMAN_STRICT) {
+        status = validate_canonical_form(numeral, length);
+    } else {
+        status = count_occurrences_of_roman_characters(numeral, length,
+                                                       &character_counts_ptr);
+    }
+    ROMAN_COUNT(validation_failures, status != ROMAN_OK);
+    return status;
+}
+
+/*
+ * Columns of numerals
+ */
+
+/**
+ * One vector scan finds where the next non-Roman byte is, so every entry
+ * before it can be decoded knowing its length and that all of its bytes are
+ * Roman. The scan only starts over once an entry reaches past that byte.
+ */
+size_t roman_decode_column(const char *data, const size_t *offsets,
+                           size_t count, roman_validation mode,
+                           uint64_t *values, roman_status *statuses)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    roman_simd_level level = roman_active_simd_level();
+    size_t end_of_data = (count > 0) ? offsets[count] : 0;
+    size_t scanned_from = 0;
+    size_t next_non_roman = 0;
+    size_t valid_entries = 0;
+    size_t start;
+    size_t end;
+
+    size_t entry;
+
+    if (count > 0) {
+        scanned_from = offsets[0];
+        next_non_roman = scanned_from
+                         + roman_find_non_roman_byte(data + scanned_from,
+                                                     end_of_data
+                                                     - scanned_from,
+                                                     level);
+    }
+
+    for (entry = 0; entry < count; entry++) {
+        start = offsets[entry];
+        end = offsets[entry + 1];
+        if (start < scanned_from || start > next_non_roman) {
+            scanned_from = start;
+            next_non_roman = start
+                             + roman_find_non_roman_byte(data + start,
+                                                         end_of_data - start,
+                                                         level);
+        }
+
+        statuses[entry] = decode_column_entry(
+            bytes + start, end - start,
+            ((next_non_roman < end) ? next_non_roman : end) - start, mode,
+            &values[entry]);
+        if (statuses[entry] == ROMAN_OK) valid_entries++;
+    }
+    ROMAN_COUNT(validation_failures, count - valid_entries);
+    return valid_entries;
+}
+
+/*
+ * Arithmetic with a scratch context
+ */
+
+roman_ctx *roman_ctx_create(void)
+{
+    return roman_allocate_zeroed(1, sizeof(roman_ctx));
+}
+
+void roman_ctx_destroy(roman_ctx *ctx)
+{
+    if (!ctx) return;
+    roman_free(ctx->buffer);
+    roman_free(ctx);
+}
+
+roman_status roman_ctx_add(roman_ctx *ctx, const char *summand1,
+                           const char *summand2, const char **sum)
+{
+    return roman_ctx_add_n(ctx, summand1, strlen(summand1), summand2,
+                           strlen(summand2), sum);
+}
+
+roman_status roman_ctx_subtract(roman_ctx *ctx, const char *numeral1,
+                                const char *numeral2,
+                                const char **difference)
+{
+    return roman_ctx_subtract_n(ctx, numeral1, strlen(numeral1), numeral2,
+                                strlen(numeral2), difference);
+}
+
+roman_status roman_ctx_add_n(roman_ctx *ctx, const char *summand1,
+                             size_t length1, const char *summand2,
+                             size_t length2, const char **sum)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
+
+    *sum = NULL;
+    status = compute_sum_character_counts(summand1, length1, summand2,
+                                          length2, &character_counts);
+    if (status != ROMAN_OK) return status;
+
+    return character_counts_to_context(ctx, character_counts, sum);
+}
+
+roman_status roman_ctx_subtract_n(roman_ctx *ctx, const char *numeral1,
+                                  size_t length1, const char *numeral2,
+                                  size_t length2, const char **difference)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
+
+    *difference = NULL;
+    status = compute_difference_character_counts(numeral1, length1, numeral2,
+                                                 length2, &character_counts);
+    if (status != ROMAN_OK) return status;
+
+    return character_counts_to_context(ctx, character_counts, difference);
+}
+
+/**
+ * Evaluate an expression of the form "A + B" or "A - B", which need not be
+ * '\0'-terminated. Whitespace around the numerals and the operator is
+ * ignored, so a line with its trailing newline can be passed as it is.
+ */
+roman_status roman_ctx_evaluate(roman_ctx *ctx, const char *expression,
+                                size_t length, const char **result)
+{
+    const char *end = expression + length;
+    const char *operator = expression;
+    const char *operand1_end;
+    const char *operand2;
+
+    *result = NULL;
+    while (operator < end && *operator != '+' && *operator != '-') {
+        operator++;
+    }
+    if (operator == end) return ROMAN_ERR_SYNTAX;
+
+    expression = skip_whitespace(expression, operator);
+    operand1_end = trim_trailing_whitespace(expression, operator);
+    operand2 = skip_whitespace(operator + 1, end);
+    end = trim_trailing_whitespace(operand2, end);
+
+    /* The operands are read where they are, without copying them out. */
+    if (*operator == '+') {
+        return roman_ctx_add_n(ctx, expression, operand1_end - expression,
+                               operand2, end - operand2, result);
+    }
+    return roman_ctx_subtract_n(ctx, expression, operand1_end - expression,
+                                operand2, end - operand2, result);
+}
+
+/** Render character counts into a context's buffer. */
+static roman_status character_counts_to_context(roman_ctx *ctx,
+                                                const int *character_counts,
+                                                const char **result)
+{
+    size_t length = rendered_length_of_character_counts(character_counts);
+
+    if (!reserve_context_buffer(&ctx->buffer, &ctx->capacity, length + 1)) {
+        return ROMAN_ERR_OUT_OF_MEMORY;
+    }
+
+    write_character_counts(character_counts, ctx->buffer);
+    *result = ctx->buffer;
+    return ROMAN_OK;
+}
+
+/**
+ * Make sure a context buffer holds at least needed bytes, at least doubling
+ * it whenever it has to grow so that a thread soon stops reallocating.
+ * Returns 0 if memory ran out.
+ */
+static int reserve_context_buffer(char **buffer, size_t *capacity,
+                                  size_t needed)
+{
+    size_t new_capacity;
+    char *new_buffer;
+
+    if (needed <= *capacity) return 1;
+
+    new_capacity = (*capacity * 2 > needed) ? *capacity * 2 : needed;
+    new_buffer = roman_reallocate(*buffer, new_capacity);
+    if (!new_buffer) return 0;
+
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return 1;
+}
+
+static const char *skip_whitespace(const char *start, const char *end)
+{
+    while (start < end && (*start == ' ' || *start == '\t'
+                           || *start == '\r' || *start == '\n')) {
+        start++;
+    }
+    return start;
+}
+
+static const char *trim_trailing_whitespace(const char *start,
+                                            const char *end)
+{
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t'
+                           || end[-1] == '\r' || end[-1] == '\n')) {
+        end--;
+    }
+    return end;
+}
+
+/*
+ * Arithmetic into an arena
+ */
+
+roman_arena *roman_arena_create(size_t block_size)
+{
+    roman_arena *arena = roman_allocate(sizeof(roman_arena));
+    if (!arena) return NULL;
+
+    arena->block_size = (block_size > 0) ? block_size : 4096;
+    arena->first = create_arena_block(arena->block_size);
+    if (!arena->first) {
+        roman_free(arena);
+        return NULL;
+    }
+    arena->current = arena->first;
+    return arena;
+}
+
+void roman_arena_destroy(roman_arena *arena)
+{
+    arena_block *block;
+    arena_block *next;
+
+    if (!arena) return;
+    for (block = arena->first; block; block = next) {
+        next = block->next;
+        roman_free(block);
+    }
+    roman_free(arena);
+}
+
+/** Keeps every block for reuse, so a steady workload stops allocating. */
+void roman_arena_reset(roman_arena *arena)
+{
+    arena_block *block;
+    for (block = arena->first; block; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = arena->first;
+}
+
+roman_status roman_arena_add(roman_arena *arena, const char *summand1,
+                             const char *summand2, const char **sum)
+{
+    return roman_arena_add_n(arena, summand1, strlen(summand1), summand2,
+                             strlen(summand2), sum);
+}
+
+roman_status roman_arena_subtract(roman_arena *arena, const char *numeral1,
+                                  const char *numeral2,
+                                  const char **difference)
+{
+    return roman_arena_subtract_n(arena, numeral1, strlen(numeral1), numeral2,
+                                  strlen(numeral2), difference);
+}
+
+roman_status roman_arena_add_n(roman_arena *arena, const char *summand1,
+                               size_t length1, const char *summand2,
+                               size_t length2, const char **sum)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
+
+    *sum = NULL;
+    status = compute_sum_character_counts(summand1, length1, summand2,
+                                          length2, &character_counts);
+    if (status != ROMAN_OK) return status;
+
+    return character_counts_to_arena(arena, character_counts, sum);
+}
+
+roman_status roman_arena_subtract_n(roman_arena *arena, const char *numeral1,
+                                    size_t length1, const char *numeral2,
+                                    size_t length2, const char **difference)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
+
+    *difference = NULL;
+    status = compute_difference_character_counts(numeral1, length1, numeral2,
+                                                 length2, &character_counts);
+    if (status != ROMAN_OK) return status;
+
+    return character_counts_to_arena(arena, character_counts, difference);
+}
+
+/** Render character counts into exactly as many arena bytes as they need. */
+static roman_status character_counts_to_arena(roman_arena *arena,
+                                              const int *character_counts,
+                                              const char **result)
+{
+    size_t length = rendered_length_of_character_counts(character_counts);
+    char *location = allocate_from_arena(arena, length + 1);
+
+    if (!location) return ROMAN_ERR_OUT_OF_MEMORY;
+
+    write_character_counts(character_counts, location);
+    *result = location;
+    return ROMAN_OK;
+}
+
+/**
+ * Bump-allocate size bytes from the current block. When they do not fit,
+ * move on to the next block (left over from before a reset) or to a new one
+ * inserted after the current one; a result bigger than the block size gets a
+ * block of its own.
+ */
+static char *allocate_from_arena(roman_arena *arena, size_t size)
+{
+    arena_block *block = arena->current;
+    arena_block *new_block;
+
+    if (block->capacity - block->used < size) {
+        if (block->next && block->next->capacity >= size) {
+            block = block->next;
+        } else {
+            new_block = create_arena_block((size > arena->block_size)
+                                           ? size : arena->block_size);
+            if (!new_block) return NULL;
+            new_block->next = block->next;
+            block->next = new_block;
+            block = new_block;
+        }
+        arena->current = block;
+    }
+
+    block->used += size;
+    return block->bytes + block->used - size;
+}
+
+static arena_block *create_arena_block(size_t capacity)
+{
+    arena_block *block;
+
+    if (capacity > SIZE_MAX - sizeof(arena_block)) return NULL;
+    block = roman_allocate(sizeof(arena_block) + capacity);
+    if (!block) return NULL;
+
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+/*
+ * Arithmetic on big numerals
+ */
+
+roman_status roman_big_parse(const char *numeral, roman_big *value)
+{
+    return roman_big_parse_n(numeral, strlen(numeral), value);
+}
+
+roman_status roman_big_parse_n(const char *numeral, size_t length,
+                               roman_big *value)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    size_t leading_thousands
+        = count_leading_thousands((const unsigned char *)numeral, length);
+    roman_status status;
+
+    if (length == 0) return ROMAN_ERR_EMPTY_INPUT;
+
+    /*
+     * 'M' is never the smaller character of a subtractive form, so the
+     * leading run of them can be counted on its own.
+     */
+    if (leading_thousands < length) {
+        status = count_occurrences_of_roman_characters(
+                     numeral + leading_thousands, length - leading_thousands,
+                     &character_counts);
+        if (status != ROMAN_OK) return ROMAN_COUNT_INVALID(status);
+        compute_carryovers(&character_counts);
+    }
+
+    return character_counts_to_big_numeral(&character_counts,
+                                           leading_thousands, value);
+}
+
+roman_status roman_big_add(const roman_big *summand1,
+                           const roman_big *summand2, roman_big *sum)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+
+    rc_index index;
+    for (index = RCI_I; index < RCI_M; index++) {
+        character_counts[index] = summand1->tail_counts[index]
+                                  + summand2->tail_counts[index];
+    }
+    compute_carryovers(&character_counts);
+
+    if (summand1->thousands > UINT64_MAX - summand2->thousands) {
+        return ROMAN_ERR_OVERFLOW;
+    }
+    return character_counts_to_big_numeral(
+               &character_counts, summand1->thousands + summand2->thousands,
+               sum);
+}
+
+roman_status roman_big_subtract(const roman_big *numeral1,
+                                const roman_big *numeral2,
+                                roman_big *difference)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    int borrow;
+
+    rc_index index;
+
+    if (roman_big_compare(numeral1, numeral2) < 0) {
+        return ROMAN_ERR_NEGATIVE_RESULT;
+    }
+
+    /* Borrow a single 'M' if the remainders alone would go negative. */
+    borrow = compare_big_numeral_tails(numeral1, numeral2) < 0;
+    for (index = RCI_I; index < RCI_M; index++) {
+        character_counts[index] = numeral1->tail_counts[index]
+                                  - numeral2->tail_counts[index];
+    }
+    character_counts[RCI_M] = borrow;
+
+    borrow_to_remove_negative_character_counts(&character_counts);
+    compute_carryovers(&character_counts);
+
+    return character_counts_to_big_numeral(
+               &character_counts,
+               numeral1->thousands - numeral2->thousands - borrow,
+               difference);
+}
+
+int roman_big_compare(const roman_big *numeral1, const roman_big *numeral2)
+{
+    if (numeral1->thousands != numeral2->thousands) {
+        return (numeral1->thousands < numeral2->thousands) ? -1 : 1;
+    }
+    return compare_big_numeral_tails(numeral1, numeral2);
+}
+
+uint64_t roman_big_length(const roman_big *value)
+{
+    int character_counts_array[7];
+    int *character_counts = character_counts_array;
+
+    big_numeral_to_character_counts(value, &character_counts);
+
+    return value->thousands
+           + rendered_length_of_character_counts(character_counts);
+}
+
+roman_status roman_big_to_string(const roman_big *value, char **numeral)
+{
+    int character_counts_array[7];
+    int *character_counts = character_counts_array;
+    uint64_t length = roman_big_length(value);
+
+    *numeral = NULL;
+    if (length >= SIZE_MAX) return ROMAN_ERR_OVERFLOW;
+
+    *numeral = roman_allocate((size_t)length + 1);
+    if (!*numeral) return ROMAN_ERR_OUT_OF_MEMORY;
+
+    big_numeral_to_character_counts(value, &character_counts);
+
+    memset(*numeral, 'M', (size_t)value->thousands);
+    write_character_counts(character_counts,
+                           *numeral + (size_t)value->thousands);
+    return ROMAN_OK;
+}
+
+/**
+ * Hand a big numeral to write piece by piece, with the run of 'M' characters
+ * cut into chunks so that it never has to be held in memory all at once.
+ */
+roman_status roman_big_write(const roman_big *value,
+                             roman_write_function write, void *context)
+{
+    char chunk[4096];
+    const canonical_numeral *tail;
+    int character_counts_array[7];
+    int *character_counts = character_counts_array;
+    uint64_t remaining = value->thousands;
+    size_t chunk_length;
+
+    memset(chunk, 'M', (remaining < sizeof(chunk)) ? (size_t)remaining
+                                                   : sizeof(chunk));
+    while (remaining > 0) {
+        chunk_length = (remaining < sizeof(chunk)) ? (size_t)remaining
+                                                   : sizeof(chunk);
+        if (write(context, chunk, chunk_length) != 0) {
+            return ROMAN_ERR_WRITE_FAILED;
+        }
+        remaining -= chunk_length;
+    }
+
+    big_numeral_to_character_counts(value, &character_counts);
+    tail = &canonical_numerals[value_below_one_thousand(character_counts)];
+
+    if (tail->length > 0
+        && write(context, tail->numeral, tail->length) != 0) {
+        return ROMAN_ERR_WRITE_FAILED;
+    }
+    return ROMAN_OK;
+}
+
+/*
+ * Accumulators
+ */
+
+void roman_acc_init(roman_acc *acc)
+{
+    memset(acc, 0, sizeof(roman_acc));
+}
+
+roman_status roman_acc_add(roman_acc *acc, const char *numeral)
+{
+    return accumulate_numeral(acc, numeral, strlen(numeral), 1);
+}
+
+roman_status roman_acc_sub(roman_acc *acc, const char *numeral)
+{
+    return accumulate_numeral(acc, numeral, strlen(numeral), -1);
+}
+
+roman_status roman_acc_add_n(roman_acc *acc, const char *numeral,
+                             size_t length)
+{
+    return accumulate_numeral(acc, numeral, length, 1);
+}
+
+roman_status roman_acc_sub_n(roman_acc *acc, const char *numeral,
+                             size_t length)
+{
+    return accumulate_numeral(acc, numeral, length, -1);
+}
+
+roman_status roman_acc_finish(const roman_acc *acc, char **total)
+{
+    roman_big big_total;
+    roman_status status;
+
+    *total = NULL;
+    status = roman_acc_finish_big(acc, &big_total);
+    if (status != ROMAN_OK) return status;
+
+    return roman_big_to_string(&big_total, total);
+}
+
+roman_status roman_acc_finish_big(const roman_acc *acc, roman_big *total)
+{
+    roman_acc normalized = *acc;
+
+    rc_index index;
+
+    normalize_accumulator(&normalized);
+
+    /* Every count below 'M' is now non-negative and worth less than 1000. */
+    if (normalized.character_counts[RCI_M] < 0) {
+        return ROMAN_ERR_NEGATIVE_RESULT;
+    }
+
+    total->thousands = (uint64_t)normalized.character_counts[RCI_M];
+    for (index = RCI_I; index < RCI_M; index++) {
+        total->tail_counts[index] = (int)normalized.character_counts[index];
+    }
+    return ROMAN_OK;
+}
+
+/*
+ * Multiplication and division
+ */
+
+char *multiply_roman_numerals(const char *factor1, const char *factor2)
+{
+    char *product;
+    roman_multiply(factor1, factor2, &product);
+    return product;
+}
+
+char *divide_roman_numerals(const char *dividend, const char *divisor,
+                            char **remainder)
+{
+    char *quotient;
+    roman_divide(dividend, divisor, &quotient, remainder);
+    return quotient;
+}
+
+roman_status roman_multiply(const char *factor1, const char *factor2,
+                            char **product)
+{
+    return roman_multiply_n(factor1, strlen(factor1), factor2,
+                            strlen(factor2), product);
+}
+
+roman_status roman_divide(const char *dividend, const char *divisor,
+                          char **quotient, char **remainder)
+{
+    return roman_divide_n(dividend, strlen(dividend), divisor,
+                          strlen(divisor), quotient, remainder);
+}
+
+/**
+ * Multiply the carried-over character counts of the factors pairwise, each
+ * product of two characters being a shifted power of ten (see
+ * add_character_product), then carry the sum over like any other.
+ */
+roman_status roman_multiply_n(const char *factor1, size_t length1,
+                              const char *factor2, size_t length2,
+                              char **product)
+{
+    int counts1_array[7] = {0};
+    int *counts1 = counts1_array;
+    int counts2_array[7] = {0};
+    int *counts2 = counts2_array;
+    int product_counts_array[7];
+    int *product_counts = product_counts_array;
+    roman_status status;
+
+    *product = NULL;
+    status = count_carried_operands(factor1, length1, factor2, length2,
+                                    &counts1, &counts2);
+    if (status != ROMAN_OK) return status;
+
+    status = multiply_character_counts(counts1, counts2, &product_counts);
+    if (status != ROMAN_OK) return status;
+
+    *product = character_counts_to_string(product_counts);
+    return (*product) ? ROMAN_OK : ROMAN_ERR_OUT_OF_MEMORY;
+}
+
+/**
+ * Long division on character counts: the divisor is shifted up by as many
+ * powers of ten as fit under the dividend and subtracted while it fits, one
+ * power at a time, exactly the way a difference is borrowed and carried.
+ */
+roman_status roman_divide_n(const char *dividend, size_t length1,
+                            const char *divisor, size_t length2,
+                            char **quotient, char **remainder)
+{
+    int remainder_counts_array[7] = {0};
+    int *remainder_counts = remainder_counts_array;
+    int divisor_counts_array[7] = {0};
+    int *divisor_counts = divisor_counts_array;
+    int quotient_counts_array[7];
+    int *quotient_counts = quotient_counts_array;
+    roman_status status;
+
+    *quotient = NULL;
+    if (remainder) *remainder = NULL;
+    status = count_carried_operands(dividend, length1, divisor, length2,
+                                    &remainder_counts, &divisor_counts);
+    if (status != ROMAN_OK) return status;
+
+    divide_character_counts(&remainder_counts, divisor_counts,
+                            &quotient_counts);
+
+    *quotient = character_counts_to_string(quotient_counts);
+    if (!*quotient) return ROMAN_ERR_OUT_OF_MEMORY;
+    if (remainder) {
+        *remainder = character_counts_to_string(remainder_counts);
+        if (!*remainder) {
+            roman_free(*quotient);
+            *quotient = NULL;
+            return ROMAN_ERR_OUT_OF_MEMORY;
+        }
+    }
+    return ROMAN_OK;
+}
+
+/*
+ * Batch arithmetic
+ */
+
+size_t roman_add_batch(const char *const *summands1,
+                       const char *const *summands2, size_t count,
+                       char *arena, size_t arena_capacity,
+                       size_t *offsets, roman_status *statuses)
+{
+    return run_batch(compute_sum_character_counts, summands1, summands2,
+                     count, arena, arena_capacity, offsets, statuses);
+}
+
+size_t roman_subtract_batch(const char *const *numerals1,
+                            const char *const *numerals2, size_t count,
+                            char *arena, size_t arena_capacity,
+                            size_t *offsets, roman_status *statuses)
+{
+    return run_batch(compute_difference_character_counts, numerals1,
+                     numerals2, count, arena, arena_capacity, offsets,
+                     statuses);
+}
+
+/**
+ * Apply an operation to each pair of numerals, packing the '\0'-terminated
+ * results one after another into the arena. Returns the number of arena bytes
+ * needed to hold every valid result.
+ */
+static size_t run_batch(character_counts_operation operation,
+                        const char *const *numerals1,
+                        const char *const *numerals2, size_t count,
+                        char *arena, size_t arena_capacity,
+                        size_t *offsets, roman_status *statuses)
+{
+    int character_counts_array[7];
+    int *character_counts = character_counts_array;
+    size_t arena_used = 0;
+    size_t length;
+
+    size_t current;
+    for (current = 0; current < count; current++) {
+        offsets[current] = arena_used;
+
+        memset(character_counts_array, 0, sizeof(character_counts_array));
+        statuses[current] = operation(numerals1[current],
+                                      strlen(numerals1[current]),
+                                      numerals2[current],
+                                      strlen(numerals2[current]),
+                                      &character_counts);
+        if (statuses[current] != ROMAN_OK) continue;
+
+        length = rendered_length_of_character_counts(character_counts);
+        if (arena_used + length < arena_capacity) {
+            write_character_counts(character_counts, arena + arena_used);
+            statuses[current] = ROMAN_OK;
+        } else {
+            statuses[current] = ROMAN_ERR_NO_SPACE;
+        }
+        arena_used += length + 1;
+    }
+    return arena_used;
+}
+
+/*
+ * Helpers for big numerals
+ */
+
+/** Character counts of the part of a big numeral below 1000. */
+static void big_numeral_to_character_counts(const roman_big *value,
+                                            int **character_counts_ptr)
+{
+    int *character_counts = *character_counts_ptr;
+
+    rc_index index;
+    for (index = RCI_I; index < RCI_M; index++) {
+        character_counts[index] = value->tail_counts[index];
+    }
+    character_counts[RCI_M] = 0;
+}
+
+/**
+ * Store carried-over character counts in a big numeral, adding their 'M'
+ * characters to the given number of thousands.
+ */
+static roman_status character_counts_to_big_numeral(
+    int **character_counts_ptr, uint64_t thousands, roman_big *value)
+{
+    int *character_counts = *character_counts_ptr;
+
+    rc_index index;
+
+    if ((uint64_t)character_counts[RCI_M] > UINT64_MAX - thousands) {
+        return ROMAN_ERR_OVERFLOW;
+    }
+
+    value->thousands = thousands + character_counts[RCI_M];
+    for (index = RCI_I; index < RCI_M; index++) {
+        value->tail_counts[index] = character_counts[index];
+    }
+    return ROMAN_OK;
+}
+
+/**
+ * Carried-over character counts are ordered like the strings they stand for,
+ * so the parts below 1000 compare from their largest character down.
+ */
+static int compare_big_numeral_tails(const roman_big *value1,
+                                     const roman_big *value2)
+{
+    rc_index index;
+    for (index = RCI_D; index < RCI_END; index--) {
+        if (value1->tail_counts[index] != value2->tail_counts[index]) {
+            return (value1->tail_counts[index] < value2->tail_counts[index])
+                   ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Helpers for accumulators
+ */
 
-/* Helpers that directly manipulate a character_counts array */
-static void  count_occurrences_of_roman_characters(const char *roman_numeral,
-                                                   int **symbol_counts_ptr);
-static void  flag_where_subtractive_forms_are_needed(int **character_counts_ptr);
-static void  compute_carryovers(int **symbol_counts_ptr);
-static void  borrow_to_remove_negative_character_counts(int **character_counts);
-static void  replace_larger_numeral_with_smaller(int **character_counts_ptr,
-                                                 rc_index larger,
-                                                 rc_index smaller,
-                                                 int number_to_replace);
-static void  subtractive_form_to_character_counts(rc_index index1,
-                                                  rc_index index2,
-                                                  int **character_counts_ptr);
+static roman_status accumulate_numeral(roman_acc *acc, const char *numeral,
+                                       size_t length, int sign)
+{
+    int character_counts_array[7] = {0};
+    int *character_counts = character_counts_array;
+    roman_status status;
 
-/* Helpers for building result strings */
-static char *character_counts_to_string(const int *character_counts);
-static void  insert_copies_of_character(char **location,
-                                        rc_index character_index,
-                                        int number_of_copies);
-static void  insert_subtractive_form(char **location, rc_index index,
-                                     int quantity);
-static int   relative_roman_character_value(char old_char, char new_char);
+    rc_index index;
 
-/* General purpose predicate functions */
-static int   at_power_of_ten(rc_index index);
-static int   at_subtractive_form(rc_index index1, rc_index index2);
-static int   not_a_roman_numeral(const char *input);
-static int   requires_subtractive_notation(rc_index index, int count);
+    status = count_occurrences_of_roman_characters(numeral, length,
+                                                   &character_counts);
+    if (status != ROMAN_OK) return ROMAN_COUNT_INVALID(status);
 
-/* Helpers for working with roman characters and their enum indices */
-static rc_index get_index(char roman_character);
-static rc_index get_index_of_first_positive_count(rc_index start,
-                                                  int **character_counts_ptr);
+    if (accumulator_would_overflow(acc, character_counts)) {
+        normalize_accumulator(acc);
+        if (accumulator_would_overflow(acc, character_counts)) {
+            return ROMAN_ERR_OVERFLOW;
+        }
+    }
 
-/* Helpers for manipulating arrays */
-static int   sum_over_array(const int *array);
-static void  subtract_arrays(int **array1, int **array2);
+    for (index = RCI_I; index < RCI_END; index++) {
+        acc->character_counts[index] += sign * character_counts[index];
+    }
+    return ROMAN_OK;
+}
+
+/** Whether adding or subtracting the counts could overflow any total. */
+static int accumulator_would_overflow(const roman_acc *acc,
+                                      const int *character_counts)
+{
+    rc_index index;
+    for (index = RCI_I; index < RCI_END; index++) {
+        if (acc->character_counts[index] > INT64_MAX - character_counts[index]
+            || acc->character_counts[index]
+               < -INT64_MAX + character_counts[index]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Carry every count below 'M' over into the next larger character, rounding
+ * down so that negative counts borrow instead. Afterwards each of those counts
+ * is between zero and its conversion rate, and 'M' holds the signed rest.
+ */
+static void normalize_accumulator(roman_acc *acc)
+{
+    int64_t *character_counts = acc->character_counts;
+
+    int64_t conversion_rate;
+    int64_t quotient;
+
+    rc_index index;
+    for (index = RCI_I; index < RCI_M; index++) {
+        conversion_rate
+            = relative_roman_character_value(roman_characters[index + 1],
+                                             roman_characters[index]);
+
+        quotient = character_counts[index] / conversion_rate;
+        if (character_counts[index] % conversion_rate < 0) quotient--;
+
+        character_counts[index] -= quotient * conversion_rate;
+        character_counts[index + 1] += quotient;
+    }
+}
 
 /*
- * Our Roman numeral arithmetic functions
+ * Helpers for multiplication and division
  */
 
-char *add_roman_numerals(const char *summand1, const char *summand2)
+/** Count both numerals into zeroed arrays and carry each over. */
+static roman_status count_carried_operands(const char *numeral1,
+                                           size_t length1,
+                                           const char *numeral2,
+                                           size_t length2,
+                                           int **counts1_ptr,
+                                           int **counts2_ptr)
 {
-    validate_input_strings(summand1, summand2);
+    roman_status status;
 
-    int *character_counts = calloc(7, sizeof(int));
+    ROMAN_COUNT(calls, 1);
+    status = count_occurrences_of_roman_characters(numeral1, length1,
+                                                   counts1_ptr);
+    if (status != ROMAN_OK) return ROMAN_COUNT_INVALID(status);
+    status = count_occurrences_of_roman_characters(numeral2, length2,
+                                                   counts2_ptr);
+    if (status != ROMAN_OK) return ROMAN_COUNT_INVALID(status);
 
-    count_occurrences_of_roman_characters(summand1, &character_counts);
-    count_occurrences_of_roman_characters(summand2, &character_counts);
+    compute_carryovers(counts1_ptr);
+    compute_carryovers(counts2_ptr);
+    return ROMAN_OK;
+}
 
-    compute_carryovers(&character_counts);
-    flag_where_subtractive_forms_are_needed(&character_counts);
+/**
+ * Only characters below 'M' are carried over in int counts: every product
+ * worth 1000 or more goes straight into a 64-bit count of 'M' characters,
+ * which may not end up longer than a numeral the library would accept.
+ */
+static roman_status multiply_character_counts(const int *factor1,
+                                              const int *factor2,
+                                              int **product_ptr)
+{
+    uint64_t thousands = 0;
 
-    char *sum = character_counts_to_string(character_counts);
+    rc_index index1;
+    rc_index index2;
 
-    free(character_counts);
-    return sum;
+    memset(*product_ptr, 0, 7 * sizeof(int));
+    for (index1 = RCI_I; index1 < RCI_END; index1++) {
+        if (factor1[index1] == 0) continue;
+        for (index2 = RCI_I; index2 < RCI_END; index2++) {
+            if (factor2[index2] == 0) continue;
+            if (!add_character_product(index1, index2,
+                                       (uint64_t)factor1[index1]
+                                       * (uint64_t)factor2[index2],
+                                       product_ptr, &thousands)) {
+                return ROMAN_ERR_OVERFLOW;
+            }
+        }
+    }
+
+    if (!finish_thousands(product_ptr, thousands)) return ROMAN_ERR_OVERFLOW;
+    return ROMAN_OK;
 }
 
-char *subtract_roman_numerals(const char *numeral1, const char *numeral2)
+/**
+ * Leave the remainder of dividing the carried-over counts in remainder_ptr
+ * by those of divisor in remainder_ptr, and the quotient in quotient_ptr.
+ * Shifted divisors larger than the remainder are never built, so nothing
+ * here can overflow.
+ */
+static void divide_character_counts(int **remainder_ptr, const int *divisor,
+                                    int **quotient_ptr)
 {
-    validate_input_strings(numeral1, numeral2);
+    int scaled_array[7];
+    int *scaled = scaled_array;
+    uint64_t thousands = 0;
+    unsigned exponent = 0;
 
-    int *character_counts = calloc(7, sizeof(int));
-    int *numeral2_counts = calloc(7, sizeof(int));
+    memset(*quotient_ptr, 0, 7 * sizeof(int));
+    if (compare_character_counts(*remainder_ptr, divisor) < 0) return;
 
-    count_occurrences_of_roman_characters(numeral1, &character_counts);
-    count_occurrences_of_roman_characters(numeral2, &numeral2_counts);
+    while (scale_character_counts(divisor, exponent + 1, &scaled)
+           && compare_character_counts(*remainder_ptr, scaled) >= 0) {
+        exponent++;
+    }
 
-    subtract_arrays(&character_counts, &numeral2_counts);
-    borrow_to_remove_negative_character_counts(&character_counts);
+    for (;;) {
+        scale_character_counts(divisor, exponent, &scaled);
+        while (compare_character_counts(*remainder_ptr, scaled) >= 0) {
+            subtract_arrays(remainder_ptr, &scaled);
+            borrow_to_remove_negative_character_counts(remainder_ptr);
+            compute_carryovers(remainder_ptr);
+            add_power_of_ten(0, exponent, 1, quotient_ptr, &thousands);
+        }
+        if (exponent == 0) break;
+        exponent--;
+    }
 
-    compute_carryovers(&character_counts);
-    flag_where_subtractive_forms_are_needed(&character_counts);
+    finish_thousands(quotient_ptr, thousands);
+}
 
-    char *difference = character_counts_to_string(character_counts);
+/**
+ * Multiply carried-over counts by 10 to the exponent into scaled_ptr, every
+ * character moving up two places per power. Returns 0 if the result would
+ * be too long to be a numeral.
+ */
+static int scale_character_counts(const int *character_counts,
+                                  unsigned exponent, int **scaled_ptr)
+{
+    uint64_t thousands = 0;
 
-    free(numeral2_counts);
-    free(character_counts);
-    return difference;
+    rc_index index;
+
+    memset(*scaled_ptr, 0, 7 * sizeof(int));
+    for (index = RCI_I; index < RCI_END; index++) {
+        if (character_counts[index] == 0) continue;
+        if (!add_power_of_ten(index % 2, index / 2 + exponent,
+                              (uint64_t)character_counts[index], scaled_ptr,
+                              &thousands)) {
+            return 0;
+        }
+    }
+    return finish_thousands(scaled_ptr, thousands);
 }
 
-/*
- * Input validation
+/**
+ * Add copies of the product of two characters. Each character is 10^e or
+ * 5 * 10^e (e being half its rc_index), so their product is a power of ten
+ * times 1, 5 or 25, and 25 * 10^e is written as 2 * 10^(e + 1) + 5 * 10^e.
+ */
+static int add_character_product(rc_index index1, rc_index index2,
+                                 uint64_t copies, int **character_counts_ptr,
+                                 uint64_t *thousands)
+{
+    unsigned fives = index1 % 2 + index2 % 2;
+    unsigned exponent = index1 / 2 + index2 / 2;
+
+    if (fives < 2) {
+        return add_power_of_ten(fives, exponent, copies,
+                                character_counts_ptr, thousands);
+    }
+    return copies <= UINT64_MAX / 2
+           && add_power_of_ten(0, exponent + 1, 2 * copies,
+                               character_counts_ptr, thousands)
+           && add_power_of_ten(1, exponent, copies, character_counts_ptr,
+                               thousands);
+}
+
+/**
+ * Add copies of 10^exponent (or of 5 * 10^exponent if five is set): to the
+ * count of the character worth that below 1000, and to thousands otherwise.
+ * Below 1000 copies is always small, since only characters below 'M' can
+ * multiply to less. Returns 0 if thousands would overflow.
+ */
+static int add_power_of_ten(unsigned five, unsigned exponent,
+                            uint64_t copies, int **character_counts_ptr,
+                            uint64_t *thousands)
+{
+    uint64_t weight = five ? 5 : 1;
+
+    if (exponent < 3) {
+        (*character_counts_ptr)[2 * exponent + five] += (int)copies;
+        return 1;
+    }
+
+    for (; exponent > 3; exponent--) {
+        if (weight > UINT64_MAX / 10) return 0;
+        weight *= 10;
+    }
+    if (copies > (UINT64_MAX - *thousands) / weight) return 0;
+    *thousands += copies * weight;
+    return 1;
+}
+
+/**
+ * Carry over counts whose 'M' characters are being kept in thousands, then
+ * store those; returns 0 if there are too many to be a numeral.
  */
+static int finish_thousands(int **character_counts_ptr, uint64_t thousands)
+{
+    compute_carryovers(character_counts_ptr);
 
-static void validate_input_strings(const char *input1, const char *input2)
+    thousands += (uint64_t)(*character_counts_ptr)[RCI_M];
+    if (thousands > MAXIMUM_NUMERAL_LENGTH) return 0;
+    (*character_counts_ptr)[RCI_M] = (int)thousands;
+    return 1;
+}
+
+/** Compare carried-over counts by their 'M' characters, then the rest. */
+static int compare_character_counts(const int *character_counts1,
+                                    const int *character_counts2)
 {
-    if (not_a_roman_numeral(input1) || not_a_roman_numeral(input2)) {
-        exit(EXIT_FAILURE);
+    int value1 = value_below_one_thousand(character_counts1);
+    int value2 = value_below_one_thousand(character_counts2);
+
+    if (character_counts1[RCI_M] != character_counts2[RCI_M]) {
+        return (character_counts1[RCI_M] < character_counts2[RCI_M]) ? -1 : 1;
     }
+    return (value1 > value2) - (value1 < value2);
 }
 
 /*
  * Helpers that directly manipulate a character_counts array
  */
 
-static void count_occurrences_of_roman_characters(const char *roman_numeral,
-                                                  int **character_counts_ptr)
+/**
+ * Fill a zeroed character_counts array with the sum of two Roman numerals,
+ * ready to be rendered.
+ */
+static roman_status compute_sum_character_counts(const char *summand1,
+                                                 size_t length1,
+                                                 const char *summand2,
+                                                 size_t length2,
+                                                 int **character_counts_ptr)
+{
+    roman_status status;
+
+    ROMAN_COUNT(calls, 1);
+    status = count_occurrences_of_roman_characters(summand1, length1,
+                                                   character_counts_ptr);
+    if (status != ROMAN_OK) return ROMAN_COUNT_INVALID(status);
+    status = count_occurrences_of_roman_characters(summand2, length2,
+                                                   character_counts_ptr);
+    if (status != ROMAN_OK) return ROMAN_COUNT_INVALID(status);
+
+    compute_carryovers(character_counts_ptr);
+    return ROMAN_OK;
+}
+
+/**
+ * Fill a zeroed character_counts array with the difference of two Roman
+ * numerals, ready to be rendered.
+ */
+static roman_status compute_difference_character_counts(
+    const char *numeral1, size_t length1, const char *numeral2,
+    size_t length2, int **character_counts_ptr)
+{
+    int numeral2_counts_array[7] = {0};
+    int *numeral2_counts = numeral2_counts_array;
+
+    roman_status status;
+
+    ROMAN_COUNT(calls, 1);
+    status = count_occurrences_of_roman_characters(numeral1, length1,
+                                                   character_counts_ptr);
+    if (status != ROMAN_OK) return ROMAN_COUNT_INVALID(status);
+    status = count_occurrences_of_roman_characters(numeral2, length2,
+                                                   &numeral2_counts);
+    if (status != ROMAN_OK) return ROMAN_COUNT_INVALID(status);
+
+    /*
+     * Borrowing only moves value down from larger characters, so lenient
+     * input such as "IVI" (five 'I') must be carried over before subtracting.
+     */
+    compute_carryovers(character_counts_ptr);
+    compute_carryovers(&numeral2_counts);
+
+    subtract_arrays(character_counts_ptr, &numeral2_counts);
+    borrow_to_remove_negative_character_counts(character_counts_ptr);
+
+    /* Only a negative difference leaves counts that no borrow can fix. */
+    if (has_negative_count(*character_counts_ptr)) {
+        return ROMAN_ERR_NEGATIVE_RESULT;
+    }
+
+    compute_carryovers(character_counts_ptr);
+    return ROMAN_OK;
+}
+
+/**
+ * Validate a Roman numeral of length bytes and add its character counts to
+ * character_counts, all in a single pass. Subtractive forms are found by
+ * looking one character ahead, and three strictly increasing characters in a
+ * row (as in "IVX", which can be read either as 6 = 10 - (5 - 1) or as
+ * 4 = (10 - 5) - 1) are rejected as ambiguous. The '\0'-terminated functions
+ * come here too, with the length strlen gives them.
+ */
+static roman_status count_occurrences_of_roman_characters(
+    const char *roman_numeral, size_t length, int **character_counts_ptr)
 {
     int *character_counts = *character_counts_ptr;
+    const unsigned char *numeral = (const unsigned char *)roman_numeral;
+    size_t position = 0;
 
-    rc_index current;
+    rc_index previous = RCI_END;
+    rc_index current = index_within(numeral, 0, length);
     rc_index next;
-    size_t offset;
-    for (offset = 0; offset < strlen(roman_numeral); offset++) {
-        current = get_index(roman_numeral[offset]);
-        next = get_index(roman_numeral[offset + 1]);
+    rc_index after;
+    while (current != RCI_END) {
+        /*
+         * Where the numeral does not increase, no subtractive pair or
+         * ambiguous form can straddle the current position, so a long
+         * numeral's remainder can be counted independently.
+         */
+        if (current <= previous
+            && position >= VECTORIZED_COUNTING_THRESHOLD
+            && roman_active_simd_level() != ROMAN_SIMD_NONE) {
+            return count_remaining_characters_vectorized(
+                position, roman_numeral + position, length - position,
+                &character_counts);
+        }
+
+        next = index_within(numeral, position + 1, length);
 
         if (at_subtractive_form(current, next)) {
+            after = index_within(numeral, position + 2, length);
+            if (previous < current || (after != RCI_END && next < after)) {
+                return ROMAN_ERR_AMBIGUOUS_FORM;
+            }
             subtractive_form_to_character_counts(current, next,
                                                  &character_counts);
-            offset++;
+            previous = next;
+            current = after;
+            position += 2;
         } else {
+            if (previous < current && current < next && next != RCI_END) {
+                return ROMAN_ERR_AMBIGUOUS_FORM;
+            }
             character_counts[current]++;
+            previous = current;
+            current = next;
+            position++;
         }
+
+        if (position > MAXIMUM_NUMERAL_LENGTH) return ROMAN_ERR_OVERFLOW;
     }
+
+    if (position < length) return ROMAN_ERR_INVALID_CHARACTER;
+    if (length == 0) return ROMAN_ERR_EMPTY_INPUT;
+    return ROMAN_OK;
 }
 
 /**
- * Indicate a subtractive form is needed to print the Roman numeral with the
- * passed character counts. This is accomplished by replacing character counts
- * indicating one 'D' followed by four 'C' chars with zero 'D' followed by nine
- * 'C' (similar for 'L' and 'X' as well as 'V' and 'I').
+ * Run the numeral through canonical_transitions, stopping at the first
+ * character that cannot follow what came before it, so the first problem
+ * from the left is the one reported. A run of 'M' characters, the only part
+ * of a canonical numeral that can be long, is skipped with
+ * count_leading_thousands instead.
  */
-static void flag_where_subtractive_forms_are_needed(int **character_counts_ptr)
+static roman_status validate_canonical_form(const char *roman_numeral,
+                                            size_t length)
 {
+    const unsigned char *numeral = (const unsigned char *)roman_numeral;
+    size_t position = 0;
+    unsigned state = CS_START;
+
     rc_index current;
+    if (length >= 2 && numeral[0] == 'M' && numeral[1] == 'M') {
+        position = count_leading_thousands(numeral, length);
+        state = CS_THOUSANDS;
+    }
+    while (position < length
+           && (current = roman_character_indices[numeral[position]])
+              != RCI_END) {
+        state = canonical_transitions[state][current];
+        if (state == CS_REJECT) return ROMAN_ERR_NON_CANONICAL;
+        position++;
+    }
+
+    if (position < length) return ROMAN_ERR_INVALID_CHARACTER;
+    if (length == 0) return ROMAN_ERR_EMPTY_INPUT;
+    if (length > MAXIMUM_NUMERAL_LENGTH) return ROMAN_ERR_OVERFLOW;
+    return ROMAN_OK;
+}
+
+/*
+ * Helpers for columns of numerals
+ */
+
+/**
+ * Decode one entry of a column whose first valid_length bytes are known to be
+ * Roman characters, reporting what roman_to_u64 (or, in strict mode,
+ * roman_validate) would for the same numeral.
+ */
+static roman_status decode_column_entry(const unsigned char *entry,
+                                        size_t length, size_t valid_length,
+                                        roman_validation mode,
+                                        uint64_t *value)
+{
+    *value = 0;
+    if (mode == ROMAN_STRICT && length > 0
+        && !is_canonical_prefix(entry, valid_length)) {
+        return ROMAN_ERR_NON_CANONICAL;
+    }
+    return sum_roman_characters(entry, length, value);
+}
+
+/**
+ * Decode a numeral of length bytes with the same rules as the arithmetic
+ * functions, but straight to its value: a character is subtracted when the
+ * next one is one or two ranks larger (the subtractive pairs
+ * at_subtractive_form accepts) and added otherwise. Rather than branching on
+ * them, the comparisons are turned into masks, and an ambiguous form is
+ * noticed as two rank increases in a row. A leading run of 'M' is all added,
+ * so it is skipped. Values cannot overflow before the numeral outgrows memory.
+ */
+static roman_status sum_roman_characters(const unsigned char *numeral,
+                                         size_t length, uint64_t *value)
+{
+    size_t position = count_leading_thousands(numeral, length);
+    uint64_t total = 1000 * (uint64_t)position;
+    uint64_t character_value;
+    uint64_t subtract_mask;
+    unsigned increasing;
+    unsigned previous_increasing = 0;
+    unsigned ambiguous = 0;
+    unsigned current = index_within(numeral, position, length);
+    unsigned next;
+
+    *value = 0;
+    if (length == 0) return ROMAN_ERR_EMPTY_INPUT;
+
+    for (; current != RCI_END; position++) {
+        next = index_within(numeral, position + 1, length);
+
+        /* The end of the numeral (RCI_END) never counts as larger. */
+        increasing = (next > current) & (next != RCI_END);
+        subtract_mask = -(uint64_t)((next - current - 1 < 2) & increasing);
+        ambiguous |= previous_increasing & increasing;
+
+        character_value = roman_character_values[current];
+        total += (character_value ^ subtract_mask) - subtract_mask;
+
+        previous_increasing = increasing;
+        current = next;
+    }
+
+    /* The decoder would have stopped at an ambiguous form first. */
+    if (ambiguous) return ROMAN_ERR_AMBIGUOUS_FORM;
+    if (position < length) return ROMAN_ERR_INVALID_CHARACTER;
+
+    *value = total;
+    return ROMAN_OK;
+}
+
+/**
+ * Whether the Roman characters given could start a canonical numeral,
+ * skipping a run of 'M' like validate_canonical_form.
+ */
+static int is_canonical_prefix(const unsigned char *numeral, size_t length)
+{
+    size_t position = count_leading_thousands(numeral, length);
+    unsigned state = (position >= 2) ? CS_THOUSANDS : CS_START;
+    unsigned current;
+
+    if (position < 2) position = 0;
+    for (; position < length; position++) {
+        current = roman_character_indices[numeral[position]];
+        state = canonical_transitions[state][current];
+        if (state == CS_REJECT) return 0;
+    }
+    return 1;
+}
+
+/** The number of 'M' characters a numeral starts with, compared 8 at a time */
+static size_t count_leading_thousands(const unsigned char *numeral,
+                                      size_t length)
+{
+    const uint64_t eight_thousands = (~(uint64_t)0 / 255) * 'M';
+    uint64_t word;
+    size_t run = 0;
+
+    while (run + 8 <= length) {
+        memcpy(&word, numeral + run, 8);
+        if (word != eight_thousands) break;
+        run += 8;
+    }
+    while (run < length && numeral[run] == 'M') run++;
+    return run;
+}
+
+static roman_status count_remaining_characters_vectorized(
+    size_t length_so_far, const char *remainder, size_t remaining_length,
+    int **character_counts_ptr)
+{
+    roman_character_tally tally;
+    roman_status status;
+
+    if (length_so_far + remaining_length > MAXIMUM_NUMERAL_LENGTH) {
+        return ROMAN_ERR_OVERFLOW;
+    }
+
+    status = roman_tally_characters(remainder, remaining_length,
+                                    roman_active_simd_level(), &tally);
+    if (status != ROMAN_OK) return status;
+
+    add_tally_to_character_counts(&tally, character_counts_ptr);
+    return ROMAN_OK;
+}
+
+/**
+ * The tally counts both characters of every subtractive pair on their own, so
+ * those are swapped for what the pair actually contributes.
+ */
+static void add_tally_to_character_counts(const roman_character_tally *tally,
+                                          int **character_counts_ptr)
+{
     int *character_counts = *character_counts_ptr;
+    int pair_counts_array[7];
+    int *pair_counts = pair_counts_array;
+    int number_of_pairs;
 
-    /* V, L, D, M are never the subtracted part of a form, so we skip them. */
-    for (current = RCI_I; current < RCI_M; current += 2) {
-        if (character_counts[current] == 4) {
-            replace_larger_numeral_with_smaller(&character_counts,
-                                                current + 1, current,
-                                                character_counts[current + 1]);
+    rc_index index;
+    rc_index smaller;
+    size_t distance;
+    for (index = RCI_I; index < RCI_END; index++) {
+        character_counts[index] += (int)tally->characters[index];
+    }
+
+    for (smaller = RCI_I; smaller < RCI_M; smaller++) {
+        for (distance = 1; distance <= 2; distance++) {
+            number_of_pairs = (int)tally->subtractive_pairs[smaller][distance - 1];
+            if (number_of_pairs == 0) continue;
+
+            memset(pair_counts_array, 0, sizeof(pair_counts_array));
+            subtractive_form_to_character_counts(smaller, smaller + distance,
+                                                 &pair_counts);
+            pair_counts[smaller] -= 1;
+            pair_counts[smaller + distance] -= 1;
+
+            for (index = RCI_I; index < RCI_END; index++) {
+                character_counts[index] += number_of_pairs * pair_counts[index];
+            }
         }
     }
 }
@@ -170,6 +1947,7 @@ static void compute_carryovers(int **character_counts_ptr)
         character_counts[index] = character_counts[index] % conversion_rate;
 
         character_counts[index + 1] += quotient;
+        ROMAN_COUNT(carries, quotient);
     }
 }
 
@@ -178,6 +1956,8 @@ static void borrow_to_remove_negative_character_counts(int **character_counts_pt
     int *character_counts = *character_counts_ptr;
     rc_index current;
     rc_index first_positive;
+    int conversion_rate;
+    int number_to_borrow;
     for (current = RCI_M; current < RCI_END; current--) {
         if (character_counts[current] == 0) continue;
 
@@ -186,6 +1966,33 @@ static void borrow_to_remove_negative_character_counts(int **character_counts_pt
         if (first_positive > current) {
             replace_larger_numeral_with_smaller(&character_counts,
                                                 first_positive, current, 1);
+            ROMAN_COUNT(borrows, 1);
+        }
+
+        /*
+         * Non-canonical input such as "XXXXXXXXXXXX" can leave a count too
+         * negative for a single borrow, so keep borrowing as much as needed.
+         */
+        while (character_counts[current] < 0) {
+            first_positive
+                = get_index_of_first_positive_count(current,
+                                                    &character_counts);
+            if (first_positive <= current) break;
+
+            conversion_rate
+                = relative_roman_character_value(
+                      roman_characters[first_positive],
+                      roman_characters[current]);
+            number_to_borrow
+                = (conversion_rate - 1 - character_counts[current])
+                  / conversion_rate;
+            if (number_to_borrow > character_counts[first_positive]) {
+                number_to_borrow = character_counts[first_positive];
+            }
+            replace_larger_numeral_with_smaller(&character_counts,
+                                                first_positive, current,
+                                                number_to_borrow);
+            ROMAN_COUNT(multi_step_borrows, 1);
         }
     }
 }
@@ -224,51 +2031,65 @@ void subtractive_form_to_character_counts(rc_index index1, rc_index index2,
 
 static char *character_counts_to_string(const int *character_counts)
 {
-    char *result = calloc(sum_over_array(character_counts) + 1, sizeof(char));
-    char *current_position = result;
-
-    int current_character_count;
+    size_t length = rendered_length_of_character_counts(character_counts);
+    char *result = roman_allocate((length + 1) * sizeof(char));
+    if (!result) return NULL;
 
-    rc_index index = RCI_M;
-    for (index = RCI_M; index < RCI_END; index--) {
-        current_character_count = character_counts[index];
+    write_character_counts(character_counts, result);
+    return result;
+}
 
-        if (requires_subtractive_notation(index, current_character_count)) {
-            insert_subtractive_form(&current_position, index,
-                                    current_character_count);
-        } else {
-            insert_copies_of_character(&current_position, index,
-                                       current_character_count);
-        }
-    }
+/**
+ * Render character counts into a caller-supplied buffer of the given capacity,
+ * returning the length of the full result (excluding the terminating '\0').
+ * Nothing but an empty string is written if the result does not fit.
+ */
+static size_t character_counts_to_buffer(const int *character_counts,
+                                         char *out, size_t capacity)
+{
+    size_t length = rendered_length_of_character_counts(character_counts);
 
-    char *trimmed_result = realloc(result, (strlen(result) + 1) * sizeof(char));
-    if (!trimmed_result) {
-        free(result);
-        return NULL;
+    if (length < capacity) {
+        write_character_counts(character_counts, out);
+    } else if (capacity > 0) {
+        out[0] = '\0';
     }
-    return trimmed_result;
+    return length;
 }
 
-static void insert_copies_of_character(char **location, rc_index character_index,
-                                       int number_of_copies)
+/**
+ * Carried-over counts are rendered as their 'M' characters followed by the
+ * canonical numeral for the rest, whose length is in the table, so this is
+ * exact (subtractive forms included) and costs one lookup.
+ */
+static size_t rendered_length_of_character_counts(const int *character_counts)
 {
-    memset(*location, roman_characters[character_index], number_of_copies);
-    *location += number_of_copies;
+    return character_counts[RCI_M]
+           + canonical_numerals[value_below_one_thousand(character_counts)]
+                 .length;
 }
 
-static void insert_subtractive_form(char **location, rc_index index,
-                                    int quantity)
+static void write_character_counts(const int *character_counts,
+                                   char *location)
 {
-    rc_index index_of_larger_character = index + 1;
-    if (quantity > 4) {
-        index_of_larger_character++;
-    }
+    const canonical_numeral *tail
+        = &canonical_numerals[value_below_one_thousand(character_counts)];
 
-    (*location)[0] = roman_characters[index];
-    (*location)[1] = roman_characters[index_of_larger_character];
+    memset(location, 'M', character_counts[RCI_M]);
+    memcpy(location + character_counts[RCI_M], tail->numeral,
+           tail->length + 1);
+    ROMAN_COUNT(bytes_rendered, character_counts[RCI_M] + tail->length);
+}
 
-    *location += 2;
+/**
+ * The value of the characters other than 'M' in carried-over character
+ * counts, which is always below 1000.
+ */
+static int value_below_one_thousand(const int *character_counts)
+{
+    return character_counts[RCI_I] + 5 * character_counts[RCI_V]
+           + 10 * character_counts[RCI_X] + 50 * character_counts[RCI_L]
+           + 100 * character_counts[RCI_C] + 500 * character_counts[RCI_D];
 }
 
 static int relative_roman_character_value(char old_char, char new_char)
@@ -292,11 +2113,15 @@ static int relative_roman_character_value(char old_char, char new_char)
 
 static rc_index get_index(char roman_character)
 {
-    rc_index index;
-    for (index = RCI_I; index < RCI_END; index++) {
-        if (roman_character == roman_characters[index]) break;
-    }
-    return index;
+    return roman_character_indices[(unsigned char)roman_character];
+}
+
+/** The index of the character at position, or RCI_END past the numeral */
+static rc_index index_within(const unsigned char *numeral, size_t position,
+                             size_t length)
+{
+    return (position < length) ? roman_character_indices[numeral[position]]
+                               : RCI_END;
 }
 
 static rc_index get_index_of_first_positive_count(rc_index start,
@@ -329,37 +2154,50 @@ static int at_subtractive_form(rc_index first_index,
         && (difference < 3);
 }
 
-static int not_a_roman_numeral(const char *input)
+static int has_negative_count(const int *character_counts)
 {
-    size_t input_length = strlen(input);
-    if (input_length == 0) return 1;
-
-    size_t current_index;
-    for(current_index = 0; current_index < input_length; current_index++) {
-        if (get_index(input[current_index]) == RCI_END) return 1;
+    rc_index index;
+    for (index = RCI_I; index < RCI_END; index++) {
+        if (character_counts[index] < 0) return 1;
     }
     return 0;
 }
 
-static int requires_subtractive_notation(rc_index index, int count)
+/*
+ * Internal stages exposed to benchmarks
+ */
+
+roman_status roman_stage_count_characters(const char *numeral,
+                                          int *character_counts)
 {
-    return index != RCI_M && count >= 4;
+    return count_occurrences_of_roman_characters(numeral, strlen(numeral),
+                                                 &character_counts);
 }
 
-/*
- * Helpers for manipulating arrays
- */
+void roman_stage_compute_carryovers(int *character_counts)
+{
+    compute_carryovers(&character_counts);
+}
 
-static int sum_over_array(const int *array)
+void roman_stage_borrow(int *character_counts)
 {
-    int sum = 0;
-    size_t index;
-    for (index = 0; index < 7; index++) {
-        sum += array[index];
-    }
-    return sum;
+    borrow_to_remove_negative_character_counts(&character_counts);
+}
+
+char *roman_stage_render(const int *character_counts)
+{
+    return character_counts_to_string(character_counts);
+}
+
+size_t roman_stage_rendered_length(const int *character_counts)
+{
+    return rendered_length_of_character_counts(character_counts);
 }
 
+/*
+ * Helpers for manipulating arrays
+ */
+
 static void subtract_arrays(int **array1, int **array2)
 {
     size_t index;
@@ -1,6 +1,393 @@
 /* roman_calculator.h */
 #ifndef ROMAN_CALCULATOR_H
 #define ROMAN_CALCULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Every function below is reentrant: it touches no state other than its
+ * arguments, so any number of threads may call them at once as long as no
+ * two of them share an output buffer, a roman_ctx or a roman_arena. A
+ * roman_cache may be shared; it does its own locking. The exception is
+ * roman_set_allocator, to be called only while no other thread is using the
+ * library.
+ */
+
+typedef enum {
+    ROMAN_OK = 0,
+    ROMAN_ERR_EMPTY_INPUT,
+    ROMAN_ERR_INVALID_CHARACTER,
+    ROMAN_ERR_AMBIGUOUS_FORM,
+    ROMAN_ERR_OVERFLOW,
+    ROMAN_ERR_NEGATIVE_RESULT,
+    ROMAN_ERR_OUT_OF_MEMORY,
+    ROMAN_ERR_NO_SPACE,
+    ROMAN_ERR_WRITE_FAILED,
+    ROMAN_ERR_SYNTAX,
+    ROMAN_ERR_NON_CANONICAL
+} roman_status;
+
+/* Both return NULL if the input is invalid or the result cannot be made. */
 char *add_roman_numerals(const char *summand1, const char *summand2);
 char *subtract_roman_numerals(const char *numeral1, const char *numeral2);
+
+/*
+ * Variants reporting why a calculation failed. On success the result is
+ * stored in *sum (*difference), otherwise that is set to NULL.
+ */
+roman_status roman_add(const char *summand1, const char *summand2,
+                       char **sum);
+roman_status roman_subtract(const char *numeral1, const char *numeral2,
+                            char **difference);
+const char *roman_status_message(roman_status status);
+
+/*
+ * Conversion between numerals and their values. roman_to_u64 accepts the same
+ * numerals as the arithmetic functions (without their length limit) and fails
+ * the same way. u64_to_roman writes the canonical numeral into out like the
+ * _into variants below, zero being the empty numeral, and roman_len_for gives
+ * its length.
+ */
+roman_status roman_to_u64(const char *numeral, uint64_t *value);
+size_t       u64_to_roman(uint64_t value, char *out, size_t capacity);
+uint64_t     roman_len_for(uint64_t value);
+
+/*
+ * Order numerals by value without allocating: roman_compare sets *order to a
+ * negative, zero or positive number as numeral1 is less than, equal to or
+ * greater than numeral2. roman_sort sorts count numeral pointers in place,
+ * stably and in ascending order, decoding each numeral once; the numerals
+ * roman_to_u64 rejects come last in their original order, and number_valid
+ * (if not NULL) receives how many came before them.
+ */
+roman_status roman_compare(const char *numeral1, const char *numeral2,
+                           int *order);
+roman_status roman_sort(const char **numerals, size_t count,
+                        size_t *number_valid);
+
+/*
+ * Check a numeral without calculating anything, in one pass and without
+ * allocating. ROMAN_LENIENT accepts exactly what the arithmetic functions
+ * accept. ROMAN_STRICT accepts only the canonical numerals they write (so not
+ * "IIII", "IC" or "VX"), reporting others as ROMAN_ERR_NON_CANONICAL.
+ */
+typedef enum { ROMAN_LENIENT, ROMAN_STRICT } roman_validation;
+
+roman_status roman_validate(const char *numeral, roman_validation mode);
+
+/*
+ * Decode a column of count numerals stored back to back in data, the way
+ * columnar formats store strings: numeral i is the bytes from offsets[i] up to
+ * offsets[i + 1], with no '\0' (so offsets holds count + 1 entries). values[i]
+ * and statuses[i] receive what roman_to_u64 would report for numeral i, a '\0'
+ * byte counting as an invalid character, or ROMAN_ERR_NON_CANONICAL in strict
+ * mode (see roman_validate). Returns the number of numerals decoded
+ * successfully.
+ */
+size_t roman_decode_column(const char *data, const size_t *offsets,
+                           size_t count, roman_validation mode,
+                           uint64_t *values, roman_status *statuses);
+
+/*
+ * Multiplication and integer division, calculated on character counts like
+ * addition. divide_roman_numerals returns the quotient and, if remainder is
+ * not NULL, stores the remainder there; a zero quotient or remainder is the
+ * empty string. A product longer than any numeral the library accepts is
+ * ROMAN_ERR_OVERFLOW.
+ */
+char *multiply_roman_numerals(const char *factor1, const char *factor2);
+char *divide_roman_numerals(const char *dividend, const char *divisor,
+                            char **remainder);
+roman_status roman_multiply(const char *factor1, const char *factor2,
+                            char **product);
+roman_status roman_divide(const char *dividend, const char *divisor,
+                          char **quotient, char **remainder);
+
+/*
+ * Variants that write their result into a caller-supplied buffer instead of
+ * allocating one. Like snprintf, they return the length of the full result
+ * (excluding the terminating '\0'); the result was written only if that length
+ * is less than capacity. Otherwise out holds an empty string (if capacity > 0).
+ * If status is not NULL it receives the outcome; invalid input returns 0.
+ */
+size_t add_roman_numerals_into(const char *summand1, const char *summand2,
+                               char *out, size_t capacity,
+                               roman_status *status);
+size_t subtract_roman_numerals_into(const char *numeral1,
+                                    const char *numeral2,
+                                    char *out, size_t capacity,
+                                    roman_status *status);
+
+/*
+ * The exact length (excluding the terminating '\0') of a sum or difference,
+ * worked out from the character counts of its numerals without rendering it,
+ * to size buffers for the variants above and below. The length is 0 if the
+ * result cannot be calculated.
+ */
+roman_status roman_add_length(const char *summand1, const char *summand2,
+                              size_t *length);
+roman_status roman_subtract_length(const char *numeral1, const char *numeral2,
+                                   size_t *length);
+
+/*
+ * Batch variants that apply an operation to count pairs of numerals. Each
+ * result is written '\0'-terminated into arena starting at offsets[i], and
+ * statuses[i] tells whether it is there: ROMAN_ERR_NO_SPACE marks a result
+ * that did not fit, any other error a pair that could not be calculated.
+ * Returns the arena capacity needed to hold every valid result.
+ */
+size_t roman_add_batch(const char *const *summands1,
+                       const char *const *summands2, size_t count,
+                       char *arena, size_t arena_capacity,
+                       size_t *offsets, roman_status *statuses);
+size_t roman_subtract_batch(const char *const *numerals1,
+                            const char *const *numerals2, size_t count,
+                            char *arena, size_t arena_capacity,
+                            size_t *offsets, roman_status *statuses);
+
+/*
+ * A scratch context owning a result buffer that is reused from one call to
+ * the next, so that a thread doing many calculations stops allocating once
+ * the buffer is big enough. Results point into the context and stay valid
+ * until its next calculation. Give each thread a context of its own.
+ */
+typedef struct roman_ctx roman_ctx;
+
+roman_ctx   *roman_ctx_create(void);
+void         roman_ctx_destroy(roman_ctx *ctx);
+roman_status roman_ctx_add(roman_ctx *ctx, const char *summand1,
+                           const char *summand2, const char **sum);
+roman_status roman_ctx_subtract(roman_ctx *ctx, const char *numeral1,
+                                const char *numeral2,
+                                const char **difference);
+
+/*
+ * Evaluate length bytes holding "A + B" or "A - B" (surrounding whitespace
+ * allowed), reporting ROMAN_ERR_SYNTAX if there is no operator.
+ */
+roman_status roman_ctx_evaluate(roman_ctx *ctx, const char *expression,
+                                size_t length, const char **result);
+
+/*
+ * An arena that results are bump-allocated from, each taking exactly its
+ * length plus one byte, in blocks of block_size bytes (4096 if 0). Results
+ * stay valid until roman_arena_reset releases all of them at once, keeping
+ * the blocks for whatever comes next, or roman_arena_destroy frees them.
+ * Give each thread an arena of its own.
+ */
+typedef struct roman_arena roman_arena;
+
+roman_arena *roman_arena_create(size_t block_size);
+void         roman_arena_destroy(roman_arena *arena);
+void         roman_arena_reset(roman_arena *arena);
+roman_status roman_arena_add(roman_arena *arena, const char *summand1,
+                             const char *summand2, const char **sum);
+roman_status roman_arena_subtract(roman_arena *arena, const char *numeral1,
+                                  const char *numeral2,
+                                  const char **difference);
+
+/*
+ * An opt-in cache of results for programs that see the same pairs over and
+ * over. It holds about capacity results, replacing the least recently used
+ * ones, and may be shared by any number of threads. Results are immutable,
+ * shared with every other caller asking for the same pair, and stay valid
+ * (even after eviction or roman_cache_destroy) until handed to
+ * roman_cache_release. On failure the result is NULL.
+ */
+typedef struct roman_cache roman_cache;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} roman_cache_stats;
+
+roman_cache *roman_cache_create(size_t capacity);
+void         roman_cache_destroy(roman_cache *cache);
+roman_status roman_cache_add(roman_cache *cache, const char *summand1,
+                             const char *summand2, const char **sum);
+roman_status roman_cache_subtract(roman_cache *cache, const char *numeral1,
+                                  const char *numeral2,
+                                  const char **difference);
+void         roman_cache_release(const char *result);
+void         roman_cache_get_stats(roman_cache *cache,
+                                   roman_cache_stats *stats);
+
+/*
+ * A Roman numeral stored as the number of 'M' characters it starts with plus
+ * the carried-over counts of its remaining characters (I, V, X, L, C and D, in
+ * that order), which together are worth less than 1000. Values with huge runs
+ * of 'M' can then be added and subtracted without ever building their strings.
+ */
+typedef struct {
+    uint64_t thousands;
+    int tail_counts[6];
+} roman_big;
+
+/* Receives the pieces of a numeral being written; returns 0 on success. */
+typedef int (*roman_write_function)(void *context, const char *bytes,
+                                    size_t length);
+
+roman_status roman_big_parse(const char *numeral, roman_big *value);
+roman_status roman_big_add(const roman_big *summand1,
+                           const roman_big *summand2, roman_big *sum);
+roman_status roman_big_subtract(const roman_big *numeral1,
+                                const roman_big *numeral2,
+                                roman_big *difference);
+int          roman_big_compare(const roman_big *numeral1,
+                               const roman_big *numeral2);
+uint64_t     roman_big_length(const roman_big *value);
+roman_status roman_big_to_string(const roman_big *value, char **numeral);
+roman_status roman_big_write(const roman_big *value,
+                             roman_write_function write, void *context);
+
+/* Line and error counts reported by roman_evaluate_lines */
+typedef struct {
+    uint64_t lines;
+    uint64_t errors;
+} roman_line_totals;
+
+/*
+ * Evaluate every line of input (see roman_ctx_evaluate) on up to
+ * number_of_threads threads. The results, one per line and each followed by
+ * '\n', are handed to write in input order in large pieces; a line that cannot
+ * be evaluated gives "error: " and its roman_status_message instead. Stops at
+ * the first failed write (ROMAN_ERR_WRITE_FAILED) or allocation. Uses pthreads,
+ * so programs calling it must be linked with -pthread.
+ */
+roman_status roman_evaluate_lines(const char *input, size_t length,
+                                  int number_of_threads,
+                                  roman_write_function write, void *context,
+                                  roman_line_totals *totals);
+
+/*
+ * Accumulates the sum of any number of numerals, added and subtracted one at a
+ * time, as signed character counts (I, V, X, L, C, D, M order) that are only
+ * carried over when they come close to overflowing. Nothing is rendered until
+ * roman_acc_finish, which also reports a negative total; an invalid numeral
+ * leaves the accumulator as it was.
+ */
+typedef struct {
+    int64_t character_counts[7];
+} roman_acc;
+
+void         roman_acc_init(roman_acc *acc);
+roman_status roman_acc_add(roman_acc *acc, const char *numeral);
+roman_status roman_acc_sub(roman_acc *acc, const char *numeral);
+roman_status roman_acc_finish(const roman_acc *acc, char **total);
+roman_status roman_acc_finish_big(const roman_acc *acc, roman_big *total);
+
+/*
+ * Variants of the functions above for numerals that sit inside a larger
+ * buffer (a line of input, a network packet, a memory-mapped file) with no
+ * '\0' after them. Each numeral is the length bytes at its pointer and nothing
+ * past them is read, so a '\0' among them is an invalid character like any
+ * other. The '\0'-terminated functions are these called with strlen, so both
+ * accept exactly the same numerals and fail the same way.
+ */
+roman_status roman_add_n(const char *summand1, size_t length1,
+                         const char *summand2, size_t length2, char **sum);
+roman_status roman_subtract_n(const char *numeral1, size_t length1,
+                              const char *numeral2, size_t length2,
+                              char **difference);
+size_t       add_roman_numerals_into_n(const char *summand1, size_t length1,
+                                       const char *summand2, size_t length2,
+                                       char *out, size_t capacity,
+                                       roman_status *status);
+size_t       subtract_roman_numerals_into_n(const char *numeral1,
+                                            size_t length1,
+                                            const char *numeral2,
+                                            size_t length2,
+                                            char *out, size_t capacity,
+                                            roman_status *status);
+roman_status roman_add_length_n(const char *summand1, size_t length1,
+                                const char *summand2, size_t length2,
+                                size_t *length);
+roman_status roman_subtract_length_n(const char *numeral1, size_t length1,
+                                     const char *numeral2, size_t length2,
+                                     size_t *length);
+roman_status roman_multiply_n(const char *factor1, size_t length1,
+                              const char *factor2, size_t length2,
+                              char **product);
+roman_status roman_divide_n(const char *dividend, size_t length1,
+                            const char *divisor, size_t length2,
+                            char **quotient, char **remainder);
+roman_status roman_to_u64_n(const char *numeral, size_t length,
+                            uint64_t *value);
+roman_status roman_compare_n(const char *numeral1, size_t length1,
+                             const char *numeral2, size_t length2,
+                             int *order);
+roman_status roman_validate_n(const char *numeral, size_t length,
+                              roman_validation mode);
+roman_status roman_ctx_add_n(roman_ctx *ctx, const char *summand1,
+                             size_t length1, const char *summand2,
+                             size_t length2, const char **sum);
+roman_status roman_ctx_subtract_n(roman_ctx *ctx, const char *numeral1,
+                                  size_t length1, const char *numeral2,
+                                  size_t length2, const char **difference);
+roman_status roman_arena_add_n(roman_arena *arena, const char *summand1,
+                               size_t length1, const char *summand2,
+                               size_t length2, const char **sum);
+roman_status roman_arena_subtract_n(roman_arena *arena, const char *numeral1,
+                                    size_t length1, const char *numeral2,
+                                    size_t length2, const char **difference);
+roman_status roman_cache_add_n(roman_cache *cache, const char *summand1,
+                               size_t length1, const char *summand2,
+                               size_t length2, const char **sum);
+roman_status roman_cache_subtract_n(roman_cache *cache, const char *numeral1,
+                                    size_t length1, const char *numeral2,
+                                    size_t length2, const char **difference);
+roman_status roman_big_parse_n(const char *numeral, size_t length,
+                               roman_big *value);
+roman_status roman_acc_add_n(roman_acc *acc, const char *numeral,
+                             size_t length);
+roman_status roman_acc_sub_n(roman_acc *acc, const char *numeral,
+                             size_t length);
+
+/*
+ * Route every allocation the library makes through allocator, or back to
+ * malloc, realloc and free if it is NULL. All three functions must be given;
+ * each receives context as its last argument. Install the allocator before
+ * any thread uses the library, and release what the library returned
+ * (strings, contexts, caches) with roman_free rather than free once it is in
+ * place.
+ */
+typedef struct {
+    void *(*allocate)(size_t size, void *context);
+    void *(*reallocate)(void *pointer, size_t size, void *context);
+    void  (*release)(void *pointer, void *context);
+    void *context;
+} roman_allocator;
+
+void roman_set_allocator(const roman_allocator *allocator);
+void roman_free(void *pointer);
+
+/*
+ * Counters of what the library did on the calling thread since it started
+ * or last called roman_reset_counters. They are only kept in builds with
+ * ROMAN_INSTRUMENTATION defined (make INSTRUMENTATION=1) and read as zero
+ * otherwise, so that ordinary builds pay nothing for them.
+ */
+typedef struct {
+    uint64_t calls;               /* additions and subtractions started */
+    uint64_t allocations;         /* including reallocations */
+    uint64_t bytes_allocated;
+    uint64_t bytes_rendered;      /* numerals written, excluding '\0' */
+    uint64_t carries;             /* characters replaced by a larger one */
+    uint64_t borrows;             /* single borrows from a larger character */
+    uint64_t multi_step_borrows;  /* extra borrows non-canonical input needs */
+    uint64_t validation_failures; /* numerals rejected as input */
+} roman_counters;
+
+void roman_get_counters(roman_counters *counters);
+void roman_reset_counters(void);
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,379 @@
+/* roman_calculator.hpp */
+#ifndef ROMAN_CALCULATOR_HPP
+#define ROMAN_CALCULATOR_HPP
+
+/*
+ * A header-only C++17 layer over roman_calculator.h whose parsing, addition
+ * and subtraction are constexpr, so arithmetic on numeral literals is folded
+ * into constants. It follows the same steps as src/roman_calculator.c: the
+ * same single-pass decoder (including its subtractive and ambiguous forms),
+ * the same carryovers and borrowing on character counts, and the same
+ * canonical rendering, so it agrees with the C library on every input.
+ *
+ *     using namespace roman::literals;
+ *     constexpr auto year = "MCMXC"_roman + "XLII"_roman;
+ *     static_assert(year.to_text().view() == "MMXXXII");
+ */
+
+#include <climits>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+#include "roman_calculator.h"
+
+namespace roman {
+
+namespace detail {
+
+/* rc_index in roman_calculator.c */
+enum index : int { I, V, X, L, C, D, M, END };
+
+inline constexpr std::size_t maximum_numeral_length = INT_MAX / 20;
+
+constexpr int index_of(char roman_character)
+{
+    switch (roman_character) {
+        case 'I': return I;
+        case 'V': return V;
+        case 'X': return X;
+        case 'L': return L;
+        case 'C': return C;
+        case 'D': return D;
+        case 'M': return M;
+        default: return END;
+    }
+}
+
+/* True for V, L and D, exactly like at_power_of_ten in the C code. */
+constexpr bool at_power_of_ten(int index)
+{
+    return index % 2 == 1;
+}
+
+constexpr bool at_subtractive_form(int first_index, int second_index)
+{
+    int difference = second_index - first_index;
+    return second_index < END && difference > 0 && difference < 3;
+}
+
+/* How many of the smaller character the larger one is worth. */
+constexpr int relative_value(int larger, int smaller)
+{
+    const int relative_value_of_character_after_smaller
+        = at_power_of_ten(smaller) ? 2 : 5;
+    switch (larger - smaller) {
+        case 1: return relative_value_of_character_after_smaller;
+        case 2: return 10;
+        case 3: return relative_value_of_character_after_smaller * 10;
+        case 4: return 100;
+        case 5: return relative_value_of_character_after_smaller * 100;
+        case 6: return 1000;
+        default: return -1;
+    }
+}
+
+constexpr void subtractive_form_to_character_counts(int index1, int index2,
+                                                    int *character_counts)
+{
+    if (!at_power_of_ten(index1) && !at_power_of_ten(index2)) {
+        character_counts[index1 + 1] += 1;
+        character_counts[index1] += 4;
+    } else {
+        character_counts[index1] += relative_value(index2, index1) - 1;
+    }
+}
+
+constexpr void compute_carryovers(int *character_counts)
+{
+    for (int index = I; index < M; index++) {
+        int conversion_rate = relative_value(index + 1, index);
+        character_counts[index + 1] += character_counts[index]
+                                       / conversion_rate;
+        character_counts[index] %= conversion_rate;
+    }
+}
+
+constexpr int index_of_first_positive_count(int start,
+                                            const int *character_counts)
+{
+    for (int result = start + 1; result < END; result++) {
+        if (character_counts[result] > 0) return result;
+    }
+    return I;
+}
+
+constexpr void replace_larger_numeral_with_smaller(int *character_counts,
+                                                   int larger, int smaller,
+                                                   int number_to_replace)
+{
+    character_counts[larger] -= number_to_replace;
+    character_counts[smaller] += relative_value(larger, smaller)
+                                 * number_to_replace;
+}
+
+constexpr void borrow_to_remove_negative_character_counts(
+    int *character_counts)
+{
+    for (int current = M; current >= I; current--) {
+        if (character_counts[current] == 0) continue;
+
+        int first_positive = index_of_first_positive_count(current,
+                                                           character_counts);
+        if (first_positive > current) {
+            replace_larger_numeral_with_smaller(character_counts,
+                                                first_positive, current, 1);
+        }
+
+        while (character_counts[current] < 0) {
+            first_positive = index_of_first_positive_count(current,
+                                                           character_counts);
+            if (first_positive <= current) break;
+
+            int conversion_rate = relative_value(first_positive, current);
+            int number_to_borrow = (conversion_rate - 1
+                                    - character_counts[current])
+                                   / conversion_rate;
+            if (number_to_borrow > character_counts[first_positive]) {
+                number_to_borrow = character_counts[first_positive];
+            }
+            replace_larger_numeral_with_smaller(character_counts,
+                                                first_positive, current,
+                                                number_to_borrow);
+        }
+    }
+}
+
+constexpr bool has_negative_count(const int *character_counts)
+{
+    for (int index = I; index < END; index++) {
+        if (character_counts[index] < 0) return true;
+    }
+    return false;
+}
+
+/* Canonical numerals for the digits of a value below 1000 */
+inline constexpr std::string_view hundreds[10] = {
+    "", "C", "CC", "CCC", "CD", "D", "DC", "DCC", "DCCC", "CM"
+};
+inline constexpr std::string_view tens[10] = {
+    "", "X", "XX", "XXX", "XL", "L", "LX", "LXX", "LXXX", "XC"
+};
+inline constexpr std::string_view units[10] = {
+    "", "I", "II", "III", "IV", "V", "VI", "VII", "VIII", "IX"
+};
+
+} // namespace detail
+
+/* A '\0'-terminated numeral of at most Capacity characters */
+template <std::size_t Capacity>
+struct fixed_numeral {
+    char characters[Capacity + 1] = {};
+    std::size_t length = 0;
+
+    constexpr std::string_view view() const
+    {
+        return std::string_view(characters, length);
+    }
+    constexpr const char *c_str() const { return characters; }
+};
+
+/*
+ * A numeral held as carried-over character counts (I, V, X, L, C, D, M), or
+ * the status explaining why it could not be parsed or calculated. Errors
+ * carry through further arithmetic, the first one winning. The default
+ * numeral is zero, which is written as the empty string.
+ */
+struct numeral {
+    int character_counts[7] = {0, 0, 0, 0, 0, 0, 0};
+    roman_status status = ROMAN_OK;
+
+    constexpr bool ok() const { return status == ROMAN_OK; }
+
+    /* The number of characters in the canonical form of the numeral */
+    constexpr std::size_t length() const
+    {
+        std::size_t length = character_counts[detail::M];
+        for (std::string_view digit : tail_digits()) length += digit.size();
+        return length;
+    }
+
+    /* The canonical form; throws if it has more than Capacity characters. */
+    template <std::size_t Capacity = 64>
+    constexpr fixed_numeral<Capacity> to_text() const
+    {
+        fixed_numeral<Capacity> text;
+        if (!ok()) throw std::domain_error("numeral has no value");
+        if (length() > Capacity) {
+            throw std::length_error("numeral longer than its capacity");
+        }
+
+        for (int copy = 0; copy < character_counts[detail::M]; copy++) {
+            text.characters[text.length++] = 'M';
+        }
+        for (std::string_view digit : tail_digits()) {
+            for (char character : digit) {
+                text.characters[text.length++] = character;
+            }
+        }
+        text.characters[text.length] = '\0';
+        return text;
+    }
+
+private:
+    struct digits {
+        std::string_view views[3];
+        constexpr const std::string_view *begin() const { return views; }
+        constexpr const std::string_view *end() const { return views + 3; }
+    };
+
+    /* What follows the run of 'M' characters, like canonical_numerals */
+    constexpr digits tail_digits() const
+    {
+        int value = character_counts[detail::I]
+                    + 5 * character_counts[detail::V]
+                    + 10 * character_counts[detail::X]
+                    + 50 * character_counts[detail::L]
+                    + 100 * character_counts[detail::C]
+                    + 500 * character_counts[detail::D];
+        return digits{{detail::hundreds[value / 100],
+                       detail::tens[value / 10 % 10],
+                       detail::units[value % 10]}};
+    }
+};
+
+constexpr numeral failed(roman_status status)
+{
+    numeral result;
+    result.status = status;
+    return result;
+}
+
+/*
+ * Parse a numeral the way count_occurrences_of_roman_characters does. Like
+ * the C library's _n functions, it reads the whole view, so a '\0' inside it
+ * is an invalid character.
+ */
+constexpr numeral parse(std::string_view text)
+{
+    numeral result;
+    std::size_t position = 0;
+    auto index_at = [&text](std::size_t at) {
+        return (at < text.size()) ? detail::index_of(text[at]) : detail::END;
+    };
+
+    int previous = detail::END;
+    int current = index_at(0);
+    while (current != detail::END) {
+        int next = index_at(position + 1);
+
+        if (detail::at_subtractive_form(current, next)) {
+            int after = index_at(position + 2);
+            if (previous < current || (after != detail::END && next < after)) {
+                return failed(ROMAN_ERR_AMBIGUOUS_FORM);
+            }
+            detail::subtractive_form_to_character_counts(
+                current, next, result.character_counts);
+            previous = next;
+            current = after;
+            position += 2;
+        } else {
+            if (previous < current && current < next && next != detail::END) {
+                return failed(ROMAN_ERR_AMBIGUOUS_FORM);
+            }
+            result.character_counts[current]++;
+            previous = current;
+            current = next;
+            position++;
+        }
+
+        if (position > detail::maximum_numeral_length) {
+            return failed(ROMAN_ERR_OVERFLOW);
+        }
+    }
+
+    if (position < text.size()) {
+        return failed(ROMAN_ERR_INVALID_CHARACTER);
+    }
+    if (position == 0) return failed(ROMAN_ERR_EMPTY_INPUT);
+
+    detail::compute_carryovers(result.character_counts);
+    return result;
+}
+
+constexpr numeral add(const numeral &summand1, const numeral &summand2)
+{
+    if (!summand1.ok()) return summand1;
+    if (!summand2.ok()) return summand2;
+
+    numeral sum = summand1;
+    for (int index = detail::I; index < detail::END; index++) {
+        sum.character_counts[index] += summand2.character_counts[index];
+    }
+    detail::compute_carryovers(sum.character_counts);
+    return sum;
+}
+
+constexpr numeral subtract(const numeral &numeral1, const numeral &numeral2)
+{
+    if (!numeral1.ok()) return numeral1;
+    if (!numeral2.ok()) return numeral2;
+
+    numeral difference = numeral1;
+    for (int index = detail::I; index < detail::END; index++) {
+        difference.character_counts[index]
+            -= numeral2.character_counts[index];
+    }
+    detail::borrow_to_remove_negative_character_counts(
+        difference.character_counts);
+
+    if (detail::has_negative_count(difference.character_counts)) {
+        return failed(ROMAN_ERR_NEGATIVE_RESULT);
+    }
+
+    detail::compute_carryovers(difference.character_counts);
+    return difference;
+}
+
+constexpr numeral operator+(const numeral &summand1, const numeral &summand2)
+{
+    return add(summand1, summand2);
+}
+
+constexpr numeral operator-(const numeral &numeral1, const numeral &numeral2)
+{
+    return subtract(numeral1, numeral2);
+}
+
+constexpr bool operator==(const numeral &numeral1, const numeral &numeral2)
+{
+    if (numeral1.status != numeral2.status) return false;
+    for (int index = detail::I; index < detail::END; index++) {
+        if (numeral1.character_counts[index]
+            != numeral2.character_counts[index]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool operator!=(const numeral &numeral1, const numeral &numeral2)
+{
+    return !(numeral1 == numeral2);
+}
+
+namespace literals {
+
+/* Invalid literals are compile-time errors wherever a constant is needed. */
+constexpr numeral operator""_roman(const char *text, std::size_t length)
+{
+    numeral result = parse(std::string_view(text, length));
+    if (!result.ok()) throw std::invalid_argument("invalid Roman numeral");
+    return result;
+}
+
+} // namespace literals
+
+} // namespace roman
+
+#endif
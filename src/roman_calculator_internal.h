@@ -0,0 +1,102 @@
+/* roman_calculator_internal.h */
+#ifndef ROMAN_CALCULATOR_INTERNAL_H
+#define ROMAN_CALCULATOR_INTERNAL_H
+
+/*
+ * Declarations shared between the library's translation units (and its
+ * benchmarks). Nothing in here is part of the public interface.
+ */
+
+#include "roman_calculator.h"
+
+typedef enum {
+    ROMAN_SIMD_NONE, ROMAN_SIMD_SSE2, ROMAN_SIMD_AVX2
+} roman_simd_level;
+
+/*
+ * Occurrences of each Roman character in a stretch of a numeral, in rc_index
+ * order, along with the number of subtractive pairs whose smaller character
+ * has each index, split by whether the larger character is one or two indices
+ * above it ("IV" versus "IX").
+ */
+typedef struct {
+    size_t characters[7];
+    size_t subtractive_pairs[7][2];
+} roman_character_tally;
+
+/*
+ * Tally the length characters starting at numeral using the given instruction
+ * set (or the best available one below it). Fails on any character that is
+ * not Roman and on ambiguous numerals. The stretch must not start or end in
+ * the middle of a subtractive pair.
+ */
+roman_status roman_tally_characters(const char *numeral, size_t length,
+                                    roman_simd_level level,
+                                    roman_character_tally *tally);
+
+/*
+ * The offset of the first byte among the length starting at bytes that is not
+ * a Roman character, or length if they all are, using the given instruction
+ * set (or the best available one below it).
+ */
+size_t roman_find_non_roman_byte(const char *bytes, size_t length,
+                                 roman_simd_level level);
+
+/* The instruction set used when counting long numerals */
+roman_simd_level roman_active_simd_level(void);
+
+/*
+ * Cap the instruction set used when counting long numerals, mainly so that
+ * benchmarks can compare them. Not thread-safe; pass ROMAN_SIMD_AVX2 to go
+ * back to using the best available.
+ */
+void roman_limit_simd_level(roman_simd_level level);
+
+/*
+ * The library's own malloc, calloc and realloc, which go to the allocator
+ * installed with roman_set_allocator (see roman_hooks.c).
+ */
+void *roman_allocate(size_t size);
+void *roman_allocate_zeroed(size_t count, size_t size);
+void *roman_reallocate(void *pointer, size_t size);
+
+/*
+ * ROMAN_COUNT(counter, amount) adds to one of the calling thread's
+ * roman_counters in instrumented builds and compiles to nothing otherwise.
+ * ROMAN_COUNT_INVALID(status) counts a validation failure and evaluates to
+ * status, for returning it.
+ */
+#ifdef ROMAN_INSTRUMENTATION
+extern __thread roman_counters roman_thread_counters;
+#define ROMAN_COUNT(counter, amount) \
+    ((void)(roman_thread_counters.counter += (amount)))
+#define ROMAN_COUNT_INVALID(status) \
+    (roman_thread_counters.validation_failures++, (status))
+#else
+#define ROMAN_COUNT(counter, amount) ((void)0)
+#define ROMAN_COUNT_INVALID(status) (status)
+#endif
+
+/*
+ * The stages addition and subtraction are made of, exposed one by one so that
+ * benchmarks can time them. Character counts are int[7] arrays in I, V, X, L,
+ * C, D, M order.
+ */
+
+/* Validate a numeral and add its characters to character_counts. */
+roman_status roman_stage_count_characters(const char *numeral,
+                                          int *character_counts);
+
+/* Replace multiple copies of a character with the next larger one. */
+void roman_stage_compute_carryovers(int *character_counts);
+
+/* Borrow larger characters until no count left by a subtraction is negative */
+void roman_stage_borrow(int *character_counts);
+
+/* Render carried-over character counts as a newly allocated string. */
+char *roman_stage_render(const int *character_counts);
+
+/* The length of what roman_stage_render would return, without rendering it */
+size_t roman_stage_rendered_length(const int *character_counts);
+
+#endif
@@ -0,0 +1,97 @@
+/* roman_hooks.c */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "roman_calculator_internal.h"
+
+/*
+ * Every allocation the library makes goes through the functions below. They
+ * call malloc and friends directly until roman_set_allocator installs
+ * something else, so the default costs one well-predicted branch.
+ */
+static roman_allocator active_allocator;
+
+#ifdef ROMAN_INSTRUMENTATION
+__thread roman_counters roman_thread_counters;
+#endif
+
+/*
+ * Allocator hooks
+ */
+
+void roman_set_allocator(const roman_allocator *allocator)
+{
+    if (allocator) {
+        active_allocator = *allocator;
+    } else {
+        memset(&active_allocator, 0, sizeof(active_allocator));
+    }
+}
+
+void roman_free(void *pointer)
+{
+    if (!pointer) return;
+    if (active_allocator.release) {
+        active_allocator.release(pointer, active_allocator.context);
+    } else {
+        free(pointer);
+    }
+}
+
+void *roman_allocate(size_t size)
+{
+    ROMAN_COUNT(allocations, 1);
+    ROMAN_COUNT(bytes_allocated, size);
+    if (active_allocator.allocate) {
+        return active_allocator.allocate(size, active_allocator.context);
+    }
+    return malloc(size);
+}
+
+void *roman_allocate_zeroed(size_t count, size_t size)
+{
+    void *pointer;
+
+    if (!active_allocator.allocate) {
+        ROMAN_COUNT(allocations, 1);
+        ROMAN_COUNT(bytes_allocated, count * size);
+        return calloc(count, size);
+    }
+
+    if (size != 0 && count > (size_t)-1 / size) return NULL;
+    pointer = roman_allocate(count * size);
+    if (pointer) memset(pointer, 0, count * size);
+    return pointer;
+}
+
+void *roman_reallocate(void *pointer, size_t size)
+{
+    ROMAN_COUNT(allocations, 1);
+    ROMAN_COUNT(bytes_allocated, size);
+    if (active_allocator.reallocate) {
+        return active_allocator.reallocate(pointer, size,
+                                           active_allocator.context);
+    }
+    return realloc(pointer, size);
+}
+
+/*
+ * Instrumentation counters
+ */
+
+void roman_get_counters(roman_counters *counters)
+{
+#ifdef ROMAN_INSTRUMENTATION
+    *counters = roman_thread_counters;
+#else
+    memset(counters, 0, sizeof(*counters));
+#endif
+}
+
+void roman_reset_counters(void)
+{
+#ifdef ROMAN_INSTRUMENTATION
+    memset(&roman_thread_counters, 0, sizeof(roman_thread_counters));
+#endif
+}
@@ -0,0 +1,496 @@
+/* roman_simd.c */
+
+#include <string.h>
+
+#include "roman_calculator_internal.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ROMAN_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define ROMAN_X86_SIMD 0
+#endif
+
+/*
+ * Numerals are processed in blocks of 16 (SSE2) or 32 (AVX2) characters. For
+ * every character in a block we find its rc_index ("rank") along with the
+ * ranks of the one and two characters after it, loaded from the same buffer
+ * shifted by one and two bytes. Comparing those gives the subtractive pairs
+ * (the next rank is one or two higher) and ambiguous forms (the rank increases
+ * twice in a row) for the whole block at once. Per-lane counts are kept in
+ * byte-sized vector accumulators that are summed up before they can overflow.
+ *
+ * The vector loops only note that some error occurred; in that case the
+ * scalar loop runs over the numeral again to report the first one, exactly
+ * as count_occurrences_of_roman_characters would.
+ */
+#define BLOCKS_PER_FLUSH 255
+#define NUMBER_OF_PAIR_KINDS 11
+
+static roman_simd_level simd_level_limit = ROMAN_SIMD_AVX2;
+
+/* The smaller character and distance of each kind of subtractive pair */
+static const int pair_smaller_index[NUMBER_OF_PAIR_KINDS]
+    = {0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4};
+static const int pair_distance[NUMBER_OF_PAIR_KINDS]
+    = {1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2};
+
+/* Scalar tallying */
+static roman_status tally_characters_scalar(const char *numeral,
+                                            size_t length,
+                                            roman_character_tally *tally);
+static int   rank_of(char character);
+
+/* Vector tallying */
+#if ROMAN_X86_SIMD
+static size_t tally_blocks_sse2(const char *numeral, size_t length,
+                                roman_character_tally *tally, int *failed);
+static __m128i ranks_sse2(__m128i characters);
+static size_t sum_bytes_sse2(__m128i counts);
+static size_t tally_blocks_avx2(const char *numeral, size_t length,
+                                roman_character_tally *tally, int *failed);
+static __m256i ranks_avx2(__m256i characters);
+static size_t sum_bytes_avx2(__m256i counts);
+static size_t skip_roman_blocks_sse2(const char *bytes, size_t length);
+static size_t skip_roman_blocks_avx2(const char *bytes, size_t length);
+#endif
+
+/*
+ * Choosing an instruction set
+ */
+
+roman_simd_level roman_active_simd_level(void)
+{
+#if ROMAN_X86_SIMD
+    if (simd_level_limit >= ROMAN_SIMD_AVX2
+        && __builtin_cpu_supports("avx2")) {
+        return ROMAN_SIMD_AVX2;
+    }
+    if (simd_level_limit >= ROMAN_SIMD_SSE2) return ROMAN_SIMD_SSE2;
+#endif
+    return ROMAN_SIMD_NONE;
+}
+
+void roman_limit_simd_level(roman_simd_level level)
+{
+    simd_level_limit = level;
+}
+
+/*
+ * Tallying characters
+ */
+
+roman_status roman_tally_characters(const char *numeral, size_t length,
+                                    roman_simd_level level,
+                                    roman_character_tally *tally)
+{
+    roman_character_tally tail_tally;
+    size_t processed = 0;
+    int failed = 0;
+    roman_status status;
+
+    int index;
+    int distance;
+
+    if (level > roman_active_simd_level()) level = roman_active_simd_level();
+
+    memset(tally, 0, sizeof(*tally));
+    switch (level) {
+#if ROMAN_X86_SIMD
+        case ROMAN_SIMD_AVX2:
+            processed = tally_blocks_avx2(numeral, length, tally, &failed);
+            break;
+        case ROMAN_SIMD_SSE2:
+            processed = tally_blocks_sse2(numeral, length, tally, &failed);
+            break;
+#endif
+        default:
+            break;
+    }
+
+    if (failed) return tally_characters_scalar(numeral, length, tally);
+
+    /*
+     * The blocks covered every triple of characters starting before
+     * processed, so the rest can be tallied on its own.
+     */
+    status = tally_characters_scalar(numeral + processed, length - processed,
+                                     &tail_tally);
+    if (status != ROMAN_OK) {
+        return tally_characters_scalar(numeral, length, tally);
+    }
+
+    for (index = 0; index < 7; index++) {
+        tally->characters[index] += tail_tally.characters[index];
+        for (distance = 0; distance < 2; distance++) {
+            tally->subtractive_pairs[index][distance]
+                += tail_tally.subtractive_pairs[index][distance];
+        }
+    }
+    return ROMAN_OK;
+}
+
+/*
+ * Finding non-Roman bytes
+ */
+
+size_t roman_find_non_roman_byte(const char *bytes, size_t length,
+                                 roman_simd_level level)
+{
+    size_t offset = 0;
+
+    if (level > roman_active_simd_level()) level = roman_active_simd_level();
+
+    switch (level) {
+#if ROMAN_X86_SIMD
+        case ROMAN_SIMD_AVX2:
+            offset = skip_roman_blocks_avx2(bytes, length);
+            break;
+        case ROMAN_SIMD_SSE2:
+            offset = skip_roman_blocks_sse2(bytes, length);
+            break;
+#endif
+        default:
+            break;
+    }
+
+    while (offset < length && rank_of(bytes[offset]) >= 0) offset++;
+    return offset;
+}
+
+/*
+ * Scalar tallying
+ */
+
+static roman_status tally_characters_scalar(const char *numeral,
+                                            size_t length,
+                                            roman_character_tally *tally)
+{
+    int current;
+    int next;
+    int after;
+
+    size_t offset;
+
+    memset(tally, 0, sizeof(*tally));
+    for (offset = 0; offset < length; offset++) {
+        current = rank_of(numeral[offset]);
+        if (current < 0) return ROMAN_ERR_INVALID_CHARACTER;
+
+        next = (offset + 1 < length) ? rank_of(numeral[offset + 1]) : -1;
+        after = (offset + 2 < length) ? rank_of(numeral[offset + 2]) : -1;
+        if (next > current && after > next) return ROMAN_ERR_AMBIGUOUS_FORM;
+
+        tally->characters[current]++;
+        if (next - current == 1 || next - current == 2) {
+            tally->subtractive_pairs[current][next - current - 1]++;
+        }
+    }
+    return ROMAN_OK;
+}
+
+static int rank_of(char character)
+{
+    switch (character) {
+        case 'I': return 0;
+        case 'V': return 1;
+        case 'X': return 2;
+        case 'L': return 3;
+        case 'C': return 4;
+        case 'D': return 5;
+        case 'M': return 6;
+        default: return -1;
+    }
+}
+
+/*
+ * Vector tallying
+ */
+
+#if ROMAN_X86_SIMD
+
+/* Rank of each Roman character in a vector, or -1 for anything else */
+static __m128i ranks_sse2(__m128i characters)
+{
+    const char roman_characters[7] = {'I', 'V', 'X', 'L', 'C', 'D', 'M'};
+    __m128i ranks = _mm_set1_epi8(-1);
+    __m128i matches;
+
+    int index;
+    for (index = 0; index < 7; index++) {
+        matches = _mm_cmpeq_epi8(characters,
+                                 _mm_set1_epi8(roman_characters[index]));
+        ranks = _mm_or_si128(_mm_andnot_si128(matches, ranks),
+                             _mm_and_si128(matches,
+                                           _mm_set1_epi8((char)index)));
+    }
+    return ranks;
+}
+
+static size_t sum_bytes_sse2(__m128i counts)
+{
+    __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+    return (size_t)_mm_cvtsi128_si32(sums)
+           + (size_t)_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+}
+
+/**
+ * Tally whole blocks for as long as the block after each one is part of the
+ * numeral, returning the number of characters processed.
+ */
+static size_t tally_blocks_sse2(const char *numeral, size_t length,
+                                roman_character_tally *tally, int *failed)
+{
+    __m128i character_counts[7];
+    __m128i pair_counts[NUMBER_OF_PAIR_KINDS];
+    __m128i errors = _mm_setzero_si128();
+    __m128i current, upcoming, next, after;
+    __m128i rises, rises_after, steps, at_index;
+    size_t processed = 0;
+    int blocks = 0;
+
+    int index;
+    for (index = 0; index < 7; index++) {
+        character_counts[index] = _mm_setzero_si128();
+    }
+    for (index = 0; index < NUMBER_OF_PAIR_KINDS; index++) {
+        pair_counts[index] = _mm_setzero_si128();
+    }
+
+    if (length < 2 * 16) {
+        *failed = 0;
+        return 0;
+    }
+
+    /*
+     * Without a byte shuffle, ranks are expensive to find, so each block's
+     * are found once and shifted to give the ranks of the following ones.
+     */
+    upcoming = ranks_sse2(_mm_loadu_si128((const __m128i *)numeral));
+    while (length - processed >= 2 * 16) {
+        current = upcoming;
+        upcoming = ranks_sse2(_mm_loadu_si128(
+                       (const __m128i *)(numeral + processed + 16)));
+        next = _mm_or_si128(_mm_srli_si128(current, 1),
+                            _mm_slli_si128(upcoming, 15));
+        after = _mm_or_si128(_mm_srli_si128(current, 2),
+                             _mm_slli_si128(upcoming, 14));
+
+        rises = _mm_cmpgt_epi8(next, current);
+        rises_after = _mm_cmpgt_epi8(after, next);
+        errors = _mm_or_si128(errors, _mm_and_si128(rises, rises_after));
+        errors = _mm_or_si128(errors,
+                              _mm_cmpgt_epi8(_mm_setzero_si128(), current));
+
+        for (index = 0; index < 7; index++) {
+            at_index = _mm_cmpeq_epi8(current, _mm_set1_epi8((char)index));
+            character_counts[index]
+                = _mm_sub_epi8(character_counts[index], at_index);
+        }
+
+        steps = _mm_sub_epi8(next, current);
+        if (_mm_movemask_epi8(_mm_and_si128(rises,
+                _mm_cmpgt_epi8(_mm_set1_epi8(3), steps)))) {
+            for (index = 0; index < NUMBER_OF_PAIR_KINDS; index++) {
+                at_index = _mm_and_si128(
+                    _mm_cmpeq_epi8(current,
+                        _mm_set1_epi8((char)pair_smaller_index[index])),
+                    _mm_cmpeq_epi8(steps,
+                        _mm_set1_epi8((char)pair_distance[index])));
+                pair_counts[index] = _mm_sub_epi8(pair_counts[index],
+                                                  at_index);
+            }
+        }
+
+        processed += 16;
+        if (++blocks == BLOCKS_PER_FLUSH) {
+            if (_mm_movemask_epi8(errors)) break;
+            for (index = 0; index < 7; index++) {
+                tally->characters[index]
+                    += sum_bytes_sse2(character_counts[index]);
+                character_counts[index] = _mm_setzero_si128();
+            }
+            for (index = 0; index < NUMBER_OF_PAIR_KINDS; index++) {
+                tally->subtractive_pairs[pair_smaller_index[index]]
+                                        [pair_distance[index] - 1]
+                    += sum_bytes_sse2(pair_counts[index]);
+                pair_counts[index] = _mm_setzero_si128();
+            }
+            blocks = 0;
+        }
+    }
+
+    *failed = _mm_movemask_epi8(errors) != 0;
+    for (index = 0; index < 7; index++) {
+        tally->characters[index] += sum_bytes_sse2(character_counts[index]);
+    }
+    for (index = 0; index < NUMBER_OF_PAIR_KINDS; index++) {
+        tally->subtractive_pairs[pair_smaller_index[index]]
+                                [pair_distance[index] - 1]
+            += sum_bytes_sse2(pair_counts[index]);
+    }
+    return processed;
+}
+
+/**
+ * Skip whole blocks of Roman characters, returning the offset of the first
+ * non-Roman byte or of the first byte not in a whole block. Only membership
+ * is needed here, so the ranks are not worked out.
+ */
+static size_t skip_roman_blocks_sse2(const char *bytes, size_t length)
+{
+    const char roman_characters[7] = {'I', 'V', 'X', 'L', 'C', 'D', 'M'};
+    __m128i block;
+    __m128i roman;
+    int non_roman;
+    size_t offset = 0;
+
+    int index;
+    while (length - offset >= 16) {
+        block = _mm_loadu_si128((const __m128i *)(bytes + offset));
+        roman = _mm_setzero_si128();
+        for (index = 0; index < 7; index++) {
+            roman = _mm_or_si128(roman, _mm_cmpeq_epi8(block,
+                        _mm_set1_epi8(roman_characters[index])));
+        }
+
+        non_roman = _mm_movemask_epi8(roman) ^ 0xFFFF;
+        if (non_roman) return offset + __builtin_ctz(non_roman);
+        offset += 16;
+    }
+    return offset;
+}
+
+/*
+ * With AVX2 a character's rank can be looked up by its low nibble, which is
+ * different for each of the seven Roman characters; comparing the character
+ * that nibble stands for with the actual one tells whether it is Roman.
+ */
+__attribute__((target("avx2")))
+static __m256i ranks_avx2(__m256i characters)
+{
+    const __m256i ranks_by_nibble = _mm256_setr_epi8(
+        0, 0, 0, 4, 5, 0, 1, 0, 2, 0, 0, 0, 3, 6, 0, 0,
+        0, 0, 0, 4, 5, 0, 1, 0, 2, 0, 0, 0, 3, 6, 0, 0);
+    const __m256i characters_by_nibble = _mm256_setr_epi8(
+        -1, -1, -1, 'C', 'D', -1, 'V', -1, 'X', 'I', -1, -1, 'L', 'M', -1, 0,
+        -1, -1, -1, 'C', 'D', -1, 'V', -1, 'X', 'I', -1, -1, 'L', 'M', -1, 0);
+    __m256i nibbles = _mm256_and_si256(characters, _mm256_set1_epi8(0x0F));
+    __m256i roman = _mm256_cmpeq_epi8(
+        _mm256_shuffle_epi8(characters_by_nibble, nibbles), characters);
+
+    return _mm256_or_si256(_mm256_shuffle_epi8(ranks_by_nibble, nibbles),
+                           _mm256_andnot_si256(roman,
+                                               _mm256_set1_epi8(-1)));
+}
+
+__attribute__((target("avx2")))
+static size_t sum_bytes_avx2(__m256i counts)
+{
+    __m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+    __m128i halves = _mm_add_epi64(_mm256_castsi256_si128(sums),
+                                   _mm256_extracti128_si256(sums, 1));
+    return (size_t)_mm_cvtsi128_si32(halves)
+           + (size_t)_mm_cvtsi128_si32(_mm_unpackhi_epi64(halves, halves));
+}
+
+__attribute__((target("avx2")))
+static size_t tally_blocks_avx2(const char *numeral, size_t length,
+                                roman_character_tally *tally, int *failed)
+{
+    __m256i character_counts[7];
+    __m256i pair_counts[NUMBER_OF_PAIR_KINDS];
+    __m256i errors = _mm256_setzero_si256();
+    __m256i current, next, after;
+    __m256i rises, rises_after, steps, at_index;
+    size_t processed = 0;
+    int blocks = 0;
+
+    int index;
+    for (index = 0; index < 7; index++) {
+        character_counts[index] = _mm256_setzero_si256();
+    }
+    for (index = 0; index < NUMBER_OF_PAIR_KINDS; index++) {
+        pair_counts[index] = _mm256_setzero_si256();
+    }
+
+    while (length - processed > 32 + 1) {
+        current = ranks_avx2(_mm256_loadu_si256(
+                      (const __m256i *)(numeral + processed)));
+        next = ranks_avx2(_mm256_loadu_si256(
+                   (const __m256i *)(numeral + processed + 1)));
+        after = ranks_avx2(_mm256_loadu_si256(
+                    (const __m256i *)(numeral + processed + 2)));
+
+        rises = _mm256_cmpgt_epi8(next, current);
+        rises_after = _mm256_cmpgt_epi8(after, next);
+        errors = _mm256_or_si256(errors, _mm256_and_si256(rises, rises_after));
+        errors = _mm256_or_si256(errors, _mm256_cmpgt_epi8(
+                                             _mm256_setzero_si256(), current));
+
+        for (index = 0; index < 7; index++) {
+            at_index = _mm256_cmpeq_epi8(current,
+                                         _mm256_set1_epi8((char)index));
+            character_counts[index]
+                = _mm256_sub_epi8(character_counts[index], at_index);
+        }
+
+        steps = _mm256_sub_epi8(next, current);
+        if (_mm256_movemask_epi8(_mm256_and_si256(rises,
+                _mm256_cmpgt_epi8(_mm256_set1_epi8(3), steps)))) {
+            for (index = 0; index < NUMBER_OF_PAIR_KINDS; index++) {
+                at_index = _mm256_and_si256(
+                    _mm256_cmpeq_epi8(current,
+                        _mm256_set1_epi8((char)pair_smaller_index[index])),
+                    _mm256_cmpeq_epi8(steps,
+                        _mm256_set1_epi8((char)pair_distance[index])));
+                pair_counts[index] = _mm256_sub_epi8(pair_counts[index],
+                                                     at_index);
+            }
+        }
+
+        processed += 32;
+        if (++blocks == BLOCKS_PER_FLUSH) {
+            if (_mm256_movemask_epi8(errors)) break;
+            for (index = 0; index < 7; index++) {
+                tally->characters[index]
+                    += sum_bytes_avx2(character_counts[index]);
+                character_counts[index] = _mm256_setzero_si256();
+            }
+            for (index = 0; index < NUMBER_OF_PAIR_KINDS; index++) {
+                tally->subtractive_pairs[pair_smaller_index[index]]
+                                        [pair_distance[index] - 1]
+                    += sum_bytes_avx2(pair_counts[index]);
+                pair_counts[index] = _mm256_setzero_si256();
+            }
+            blocks = 0;
+        }
+    }
+
+    *failed = _mm256_movemask_epi8(errors) != 0;
+    for (index = 0; index < 7; index++) {
+        tally->characters[index] += sum_bytes_avx2(character_counts[index]);
+    }
+    for (index = 0; index < NUMBER_OF_PAIR_KINDS; index++) {
+        tally->subtractive_pairs[pair_smaller_index[index]]
+                                [pair_distance[index] - 1]
+            += sum_bytes_avx2(pair_counts[index]);
+    }
+    return processed;
+}
+/** Non-Roman bytes are the ones whose rank has its sign bit set. */
+__attribute__((target("avx2")))
+static size_t skip_roman_blocks_avx2(const char *bytes, size_t length)
+{
+    unsigned non_roman;
+    size_t offset = 0;
+
+    while (length - offset >= 32) {
+        non_roman = (unsigned)_mm256_movemask_epi8(ranks_avx2(
+                        _mm256_loadu_si256((const __m256i *)(bytes + offset))));
+        if (non_roman) return offset + __builtin_ctz(non_roman);
+        offset += 32;
+    }
+    return offset;
+}
+#endif
@@ -0,0 +1,162 @@
+/* roman_sort.c */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "roman_calculator_internal.h"
+
+/*
+ * Numerals are compared and sorted by their values, which roman_to_u64
+ * decodes in one pass without allocating. Sorting decodes every numeral once
+ * into a 64-bit key and then sorts the keys least significant byte first,
+ * skipping the bytes that are the same in every key (most of them, for
+ * values of everyday size), so it takes a few linear passes however many
+ * numerals there are.
+ */
+#define RADIX_BITS 8
+#define RADIX (1 << RADIX_BITS)
+#define KEY_BYTES 8
+
+/* An invalid numeral's key; no numeral that fits in memory is worth this. */
+#define INVALID_KEY UINT64_MAX
+
+typedef struct {
+    uint64_t key;
+    const char *numeral;
+} sort_item;
+
+static void radix_sort_items(sort_item *items, sort_item *scratch,
+                             size_t count, size_t (*histograms)[RADIX]);
+
+/*
+ * Comparison
+ */
+
+roman_status roman_compare(const char *numeral1, const char *numeral2,
+                           int *order)
+{
+    return roman_compare_n(numeral1, strlen(numeral1), numeral2,
+                           strlen(numeral2), order);
+}
+
+roman_status roman_compare_n(const char *numeral1, size_t length1,
+                             const char *numeral2, size_t length2,
+                             int *order)
+{
+    uint64_t value1;
+    uint64_t value2;
+    roman_status status;
+
+    *order = 0;
+    status = roman_to_u64_n(numeral1, length1, &value1);
+    if (status != ROMAN_OK) return status;
+    status = roman_to_u64_n(numeral2, length2, &value2);
+    if (status != ROMAN_OK) return status;
+
+    *order = (value1 > value2) - (value1 < value2);
+    return ROMAN_OK;
+}
+
+/*
+ * Sorting
+ */
+
+/**
+ * Invalid numerals get the largest key, so the stable sort leaves them at
+ * the end in the order they came in.
+ */
+roman_status roman_sort(const char **numerals, size_t count,
+                        size_t *number_valid)
+{
+    sort_item *items;
+    size_t (*histograms)[RADIX];
+    size_t valid = 0;
+
+    size_t index;
+    int byte;
+
+    if (number_valid) *number_valid = 0;
+    if (count == 0) return ROMAN_OK;
+    /* The items and the scratch space they are scattered into */
+    if (count > (size_t)-1 / (2 * sizeof(sort_item))) {
+        return ROMAN_ERR_OUT_OF_MEMORY;
+    }
+
+    items = roman_allocate(2 * count * sizeof(sort_item));
+    histograms = roman_allocate_zeroed(KEY_BYTES, sizeof(*histograms));
+    if (!items || !histograms) {
+        roman_free(items);
+        roman_free(histograms);
+        return ROMAN_ERR_OUT_OF_MEMORY;
+    }
+
+    for (index = 0; index < count; index++) {
+        items[index].numeral = numerals[index];
+        if (roman_to_u64(numerals[index], &items[index].key) == ROMAN_OK) {
+            valid++;
+        } else {
+            items[index].key = INVALID_KEY;
+        }
+        for (byte = 0; byte < KEY_BYTES; byte++) {
+            histograms[byte][(items[index].key >> (byte * RADIX_BITS))
+                             & (RADIX - 1)]++;
+        }
+    }
+
+    radix_sort_items(items, items + count, count, histograms);
+    for (index = 0; index < count; index++) {
+        numerals[index] = items[index].numeral;
+    }
+
+    roman_free(items);
+    roman_free(histograms);
+    if (number_valid) *number_valid = valid;
+    return ROMAN_OK;
+}
+
+/*
+ * Helpers for sorting
+ */
+
+/**
+ * Least significant digit radix sort of items by key, moving them between
+ * items and scratch once per byte that is not the same in every key, and
+ * leaving them sorted in items. histograms holds how many keys have each
+ * value of each byte.
+ */
+static void radix_sort_items(sort_item *items, sort_item *scratch,
+                             size_t count, size_t (*histograms)[RADIX])
+{
+    sort_item *source = items;
+    sort_item *destination = scratch;
+    sort_item *swap;
+    size_t offsets[RADIX];
+    size_t total;
+    unsigned digit;
+
+    size_t index;
+    int byte;
+
+    for (byte = 0; byte < KEY_BYTES; byte++) {
+        digit = (unsigned)((source[0].key >> (byte * RADIX_BITS))
+                           & (RADIX - 1));
+        if (histograms[byte][digit] == count) continue;
+
+        total = 0;
+        for (digit = 0; digit < RADIX; digit++) {
+            offsets[digit] = total;
+            total += histograms[byte][digit];
+        }
+        for (index = 0; index < count; index++) {
+            digit = (unsigned)((source[index].key >> (byte * RADIX_BITS))
+                               & (RADIX - 1));
+            destination[offsets[digit]++] = source[index];
+        }
+
+        swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    if (source != items) memcpy(items, source, count * sizeof(sort_item));
+}
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include "../src/roman_calculator.h"
 
@@ -9,6 +10,27 @@ static void assert_sum_equals(const char *summand1, const char *summand2,
                 const char *expected_sum);
 static void assert_difference_equals(const char *numeral1, const char *numeral2,
                 const char *expected_difference);
+static void assert_sum_fails(const char *summand1, const char *summand2,
+                roman_status expected_status);
+static char *repeat_numeral(const char *numeral, size_t copies,
+                const char *suffix);
+static void assert_big_numeral_equals(const roman_big *value,
+                const char *expected_numeral);
+static int  count_written_characters(void *context, const char *bytes,
+                size_t length);
+static int  append_written_bytes(void *context, const char *bytes,
+                size_t length);
+static void assert_difference_fails(const char *numeral1, const char *numeral2,
+                roman_status expected_status);
+static void *counting_allocate(size_t size, void *context);
+static void *counting_reallocate(void *pointer, size_t size, void *context);
+static void  counting_release(void *pointer, void *context);
+
+/* What counting_allocate and friends have seen */
+typedef struct {
+    size_t allocations;
+    size_t releases;
+} allocation_counts;
 
 /*
  * Tests for add_roman_numerals
@@ -60,18 +82,29 @@ START_TEST(sum_of_XC_and_X_is_C)
     assert_sum_equals("XC", "X", "C");
 END_TEST
 
-START_TEST(add_roman_numerals_exits_with_a_failure_state_when_first_argument_is_malformed)
-    add_roman_numerals("not a Roman numeral", "I");
+START_TEST(add_roman_numerals_returns_null_when_first_argument_is_malformed)
+    ck_assert_ptr_eq(add_roman_numerals("not a Roman numeral", "I"), NULL);
 END_TEST
 
-START_TEST(add_roman_numerals_exits_with_a_failure_state_when_second_argument_is_malformed)
-    add_roman_numerals("I", "also not a Roman numeral");
+START_TEST(add_roman_numerals_returns_null_when_second_argument_is_malformed)
+    ck_assert_ptr_eq(add_roman_numerals("I", "also not a Roman numeral"),
+                     NULL);
 END_TEST
 
 START_TEST(empty_addition_input_strings_result_in_failure)
-    assert_sum_equals("", "I", "I");
-    assert_sum_equals("I", "", "I");
-    assert_sum_equals("", "", "");
+    assert_sum_fails("", "I", ROMAN_ERR_EMPTY_INPUT);
+    assert_sum_fails("I", "", ROMAN_ERR_EMPTY_INPUT);
+    assert_sum_fails("", "", ROMAN_ERR_EMPTY_INPUT);
+END_TEST
+
+START_TEST(roman_add_reports_invalid_characters)
+    assert_sum_fails("XIIJ", "I", ROMAN_ERR_INVALID_CHARACTER);
+    assert_sum_fails("I", "xii", ROMAN_ERR_INVALID_CHARACTER);
+END_TEST
+
+START_TEST(roman_add_reports_ambiguous_numerals)
+    assert_sum_fails("IVX", "I", ROMAN_ERR_AMBIGUOUS_FORM);
+    assert_sum_fails("I", "MXCM", ROMAN_ERR_AMBIGUOUS_FORM);
 END_TEST
 
 START_TEST(sum_of_I_and_XLI_is_XLII)
@@ -86,6 +119,10 @@ START_TEST(sum_of_MMD_and_MMD_is_MMMMM)
     assert_sum_equals("MMD", "MMD", "MMMMM");
 END_TEST
 
+START_TEST(sum_of_MMMDCCCLXXXVII_and_I_is_MMMDCCCLXXXVIII)
+    assert_sum_equals("MMMDCCCLXXXVII", "I", "MMMDCCCLXXXVIII");
+END_TEST
+
 /*
  * Tests for subtract_roman_numerals
  */
@@ -134,7 +171,22 @@ START_TEST(borrowing_is_performed_correctly_when_subtracting_one_roman_char_from
 END_TEST
 
 START_TEST(subtract_roman_numerals_rejects_non_Roman_numeral_input)
-    subtract_roman_numerals("these are not", "Roman numerals");
+    ck_assert_ptr_eq(subtract_roman_numerals("these are not",
+                                             "Roman numerals"), NULL);
+END_TEST
+
+START_TEST(roman_subtract_reports_negative_results)
+    assert_difference_fails("I", "II", ROMAN_ERR_NEGATIVE_RESULT);
+    assert_difference_fails("CM", "M", ROMAN_ERR_NEGATIVE_RESULT);
+END_TEST
+
+START_TEST(borrowing_handles_long_additive_subtrahends)
+    assert_difference_equals("CC", "XXXXXXXXXXXX", "LXXX");
+END_TEST
+
+START_TEST(borrowing_handles_long_additive_minuends)
+    assert_difference_equals("IVI", "VX", "");
+    assert_difference_equals("LD", "IC", "CCCXLIX");
 END_TEST
 
 START_TEST(IX_minus_V_is_IV)
@@ -153,6 +205,1130 @@ START_TEST(MMMMM_minus_MMC_equals_MMCM)
     assert_difference_equals("MMMMM", "MMC", "MMCM");
 END_TEST
 
+/*
+ * Tests for the caller-provided buffer variants
+ */
+
+START_TEST(add_roman_numerals_into_writes_sum_into_buffer)
+    char buffer[16];
+    size_t length = add_roman_numerals_into("MCMXC", "XLII", buffer,
+                                            sizeof(buffer), NULL);
+    ck_assert_str_eq(buffer, "MMXXXII");
+    ck_assert_uint_eq(length, 7);
+END_TEST
+
+START_TEST(subtract_roman_numerals_into_writes_difference_into_buffer)
+    char buffer[16];
+    size_t length = subtract_roman_numerals_into("M", "I", buffer,
+                                                 sizeof(buffer), NULL);
+    ck_assert_str_eq(buffer, "CMXCIX");
+    ck_assert_uint_eq(length, 6);
+END_TEST
+
+START_TEST(into_variants_report_needed_length_when_buffer_is_too_small)
+    char buffer[4] = "XYZ";
+    ck_assert_uint_eq(add_roman_numerals_into("D", "CCC", buffer,
+                                              sizeof(buffer), NULL), 4);
+    ck_assert_str_eq(buffer, "");
+    ck_assert_uint_eq(subtract_roman_numerals_into("MMM", "I", NULL, 0,
+                                                   NULL), 8);
+END_TEST
+
+START_TEST(into_variants_report_invalid_input_through_status)
+    char buffer[16] = "XYZ";
+    roman_status status;
+    ck_assert_uint_eq(add_roman_numerals_into("MXQ", "I", buffer,
+                                              sizeof(buffer), &status), 0);
+    ck_assert_int_eq(status, ROMAN_ERR_INVALID_CHARACTER);
+    ck_assert_str_eq(buffer, "");
+END_TEST
+
+/** Compare with the rendered results of every pair up to a bound. */
+START_TEST(exact_lengths_match_rendered_results)
+    char numeral1[32];
+    char numeral2[32];
+    char *result;
+    size_t length;
+    roman_status status;
+
+    uint64_t value1;
+    uint64_t value2;
+
+    for (value1 = 1; value1 <= 300; value1++) {
+        u64_to_roman(value1 * 7, numeral1, sizeof(numeral1));
+        for (value2 = 1; value2 <= 300; value2++) {
+            u64_to_roman(value2 * 5, numeral2, sizeof(numeral2));
+
+            ck_assert_int_eq(roman_add_length(numeral1, numeral2, &length),
+                             ROMAN_OK);
+            result = add_roman_numerals(numeral1, numeral2);
+            ck_assert_uint_eq(length, strlen(result));
+            free(result);
+
+            status = roman_subtract_length(numeral1, numeral2, &length);
+            result = subtract_roman_numerals(numeral1, numeral2);
+            if (status == ROMAN_OK) {
+                ck_assert_uint_eq(length, strlen(result));
+            } else {
+                ck_assert_int_eq(status, ROMAN_ERR_NEGATIVE_RESULT);
+                ck_assert_ptr_eq(result, NULL);
+                ck_assert_uint_eq(length, 0);
+            }
+            free(result);
+        }
+    }
+    ck_assert_int_eq(roman_add_length("IIII", "VIIII", &length), ROMAN_OK);
+    ck_assert_uint_eq(length, 4);
+    ck_assert_int_eq(roman_add_length("IVX", "I", &length),
+                     ROMAN_ERR_AMBIGUOUS_FORM);
+END_TEST
+
+/*
+ * Tests for the batch variants
+ */
+
+START_TEST(roman_add_batch_packs_sums_into_the_arena)
+    const char *summands1[] = {"I", "MCMXC", "XC"};
+    const char *summands2[] = {"I", "XLII", "X"};
+    char arena[32];
+    size_t offsets[3];
+    roman_status statuses[3];
+
+    ck_assert_uint_eq(roman_add_batch(summands1, summands2, 3, arena,
+                                      sizeof(arena), offsets, statuses),
+                      3 + 8 + 2);
+    ck_assert_int_eq(statuses[0], ROMAN_OK);
+    ck_assert_int_eq(statuses[1], ROMAN_OK);
+    ck_assert_int_eq(statuses[2], ROMAN_OK);
+    ck_assert_str_eq(arena + offsets[0], "II");
+    ck_assert_str_eq(arena + offsets[1], "MMXXXII");
+    ck_assert_str_eq(arena + offsets[2], "C");
+END_TEST
+
+START_TEST(roman_subtract_batch_flags_malformed_pairs_without_exiting)
+    const char *numerals1[] = {"X", "not Roman", "M"};
+    const char *numerals2[] = {"I", "I", "I"};
+    char arena[32];
+    size_t offsets[3];
+    roman_status statuses[3];
+
+    roman_subtract_batch(numerals1, numerals2, 3, arena, sizeof(arena),
+                         offsets, statuses);
+    ck_assert_int_eq(statuses[0], ROMAN_OK);
+    ck_assert_int_eq(statuses[1], ROMAN_ERR_INVALID_CHARACTER);
+    ck_assert_int_eq(statuses[2], ROMAN_OK);
+    ck_assert_str_eq(arena + offsets[0], "IX");
+    ck_assert_str_eq(arena + offsets[2], "CMXCIX");
+END_TEST
+
+START_TEST(batch_results_that_do_not_fit_are_flagged)
+    const char *summands1[] = {"V", "D"};
+    const char *summands2[] = {"I", "CCC"};
+    char arena[4];
+    size_t offsets[2];
+    roman_status statuses[2];
+
+    ck_assert_uint_eq(roman_add_batch(summands1, summands2, 2, arena,
+                                      sizeof(arena), offsets, statuses),
+                      3 + 5);
+    ck_assert_int_eq(statuses[0], ROMAN_OK);
+    ck_assert_int_eq(statuses[1], ROMAN_ERR_NO_SPACE);
+    ck_assert_str_eq(arena + offsets[0], "VI");
+END_TEST
+
+/*
+ * Tests for long numerals, which are counted with vector instructions
+ */
+
+START_TEST(sum_of_long_numerals_carries_into_the_M_run)
+    char *summand1 = repeat_numeral("M", 2000, "CMXCIX");
+    char *summand2 = repeat_numeral("MCMXLIVI", 100, "");
+    char *expected_sum1 = repeat_numeral("M", 2001, "");
+    char *expected_sum2 = repeat_numeral("M", 2195, "CDXCIX");
+
+    assert_sum_equals(summand1, "I", expected_sum1);
+    assert_sum_equals(summand1, summand2, expected_sum2);
+
+    free(summand1);
+    free(summand2);
+    free(expected_sum1);
+    free(expected_sum2);
+END_TEST
+
+START_TEST(long_numerals_are_checked_for_invalid_characters)
+    char *numeral = repeat_numeral("MDCLXVI", 300, "");
+    numeral[1000] = 'Z';
+    assert_sum_fails(numeral, "I", ROMAN_ERR_INVALID_CHARACTER);
+    free(numeral);
+END_TEST
+
+START_TEST(long_numerals_are_checked_for_ambiguous_forms)
+    char *numeral = repeat_numeral("MDCLXVI", 300, "");
+    memcpy(numeral + 1001, "IVX", 3);
+    assert_sum_fails("I", numeral, ROMAN_ERR_AMBIGUOUS_FORM);
+    free(numeral);
+END_TEST
+
+/*
+ * Tests for scratch contexts
+ */
+
+START_TEST(a_context_is_reused_for_growing_results)
+    roman_ctx *ctx = roman_ctx_create();
+    char *long_numeral = repeat_numeral("M", 5000, "");
+    const char *result;
+
+    ck_assert_int_eq(roman_ctx_add(ctx, "II", "II", &result), ROMAN_OK);
+    ck_assert_str_eq(result, "IV");
+    ck_assert_int_eq(roman_ctx_add(ctx, long_numeral, "I", &result),
+                     ROMAN_OK);
+    ck_assert_uint_eq(strlen(result), 5001);
+    ck_assert_int_eq(roman_ctx_subtract(ctx, "X", "I", &result), ROMAN_OK);
+    ck_assert_str_eq(result, "IX");
+
+    free(long_numeral);
+    roman_ctx_destroy(ctx);
+END_TEST
+
+START_TEST(a_context_reports_invalid_input)
+    roman_ctx *ctx = roman_ctx_create();
+    const char *result;
+
+    ck_assert_int_eq(roman_ctx_subtract(ctx, "I", "II", &result),
+                     ROMAN_ERR_NEGATIVE_RESULT);
+    ck_assert_ptr_eq(result, NULL);
+    ck_assert_int_eq(roman_ctx_add(ctx, "I", "Q", &result),
+                     ROMAN_ERR_INVALID_CHARACTER);
+
+    roman_ctx_destroy(ctx);
+END_TEST
+
+START_TEST(a_context_evaluates_expressions)
+    roman_ctx *ctx = roman_ctx_create();
+    const char *line = "  MCMXC + XLII\r\nMM - I";
+    const char *result;
+
+    ck_assert_int_eq(roman_ctx_evaluate(ctx, line, 15, &result), ROMAN_OK);
+    ck_assert_str_eq(result, "MMXXXII");
+    ck_assert_int_eq(roman_ctx_evaluate(ctx, line + 16, 6, &result),
+                     ROMAN_OK);
+    ck_assert_str_eq(result, "MCMXCIX");
+    ck_assert_int_eq(roman_ctx_evaluate(ctx, "MMXX", 4, &result),
+                     ROMAN_ERR_SYNTAX);
+    ck_assert_int_eq(roman_ctx_evaluate(ctx, "X +", 3, &result),
+                     ROMAN_ERR_EMPTY_INPUT);
+
+    roman_ctx_destroy(ctx);
+END_TEST
+
+START_TEST(many_lines_are_evaluated_in_order_on_several_threads)
+    const char *lines[3] = {"I + I\n", "X - I\n", "I - V\n"};
+    const char *results[3] = {"II\n", "IX\n",
+                              "error: result would be negative\n"};
+    size_t number_of_lines = 30000;
+    char *input = malloc(number_of_lines * 6 + 1);
+    char *expected = malloc(number_of_lines * 33 + 1);
+    char *written = malloc(number_of_lines * 33 + 1);
+    size_t expected_length = 0;
+    roman_line_totals totals;
+
+    size_t line;
+
+    for (line = 0; line < number_of_lines; line++) {
+        strcpy(input + line * 6, lines[line % 3]);
+        strcpy(expected + expected_length, results[line % 3]);
+        expected_length += strlen(results[line % 3]);
+    }
+    written[0] = '\0';
+
+    ck_assert_int_eq(roman_evaluate_lines(input, strlen(input), 3,
+                                          append_written_bytes, written,
+                                          &totals),
+                     ROMAN_OK);
+    ck_assert_uint_eq(totals.lines, number_of_lines);
+    ck_assert_uint_eq(totals.errors, number_of_lines / 3);
+    ck_assert(strcmp(written, expected) == 0);
+
+    free(input);
+    free(expected);
+    free(written);
+END_TEST
+
+/*
+ * Tests for big numerals
+ */
+
+START_TEST(big_numerals_round_trip_through_strings)
+    roman_big value;
+    ck_assert_int_eq(roman_big_parse("MMMCMXCIX", &value), ROMAN_OK);
+    ck_assert_uint_eq(value.thousands, 3);
+    ck_assert_uint_eq(roman_big_length(&value), 9);
+    assert_big_numeral_equals(&value, "MMMCMXCIX");
+END_TEST
+
+START_TEST(big_numerals_can_be_added_and_subtracted)
+    roman_big value1, value2, result;
+    roman_big_parse("MMDCCCLXXXVIII", &value1);
+    roman_big_parse("CXII", &value2);
+
+    ck_assert_int_eq(roman_big_add(&value1, &value2, &result), ROMAN_OK);
+    assert_big_numeral_equals(&result, "MMM");
+
+    ck_assert_int_eq(roman_big_subtract(&result, &value2, &result), ROMAN_OK);
+    assert_big_numeral_equals(&result, "MMDCCCLXXXVIII");
+
+    ck_assert_int_eq(roman_big_subtract(&value2, &value1, &result),
+                     ROMAN_ERR_NEGATIVE_RESULT);
+END_TEST
+
+START_TEST(huge_big_numerals_are_written_in_chunks)
+    roman_big value1, value2, sum;
+    size_t written[2] = {0, 0};
+
+    roman_big_parse("CM", &value1);
+    roman_big_parse("CCCXLIV", &value2);
+    value1.thousands = 1000000000000ULL;
+
+    ck_assert_int_eq(roman_big_add(&value1, &value2, &sum), ROMAN_OK);
+    ck_assert_uint_eq(sum.thousands, 1000000000001ULL);
+    ck_assert_uint_eq(roman_big_length(&sum), 1000000000001ULL + 6);
+
+    value1.thousands = 10000000;
+    ck_assert_int_eq(roman_big_write(&value1, count_written_characters,
+                                     written), ROMAN_OK);
+    ck_assert_uint_eq(written[0], 10000000 + 1);
+    ck_assert_uint_eq(written[1], 1);
+END_TEST
+
+START_TEST(adding_big_numerals_reports_overflow)
+    roman_big value, sum;
+    roman_big_parse("M", &value);
+    value.thousands = UINT64_MAX;
+    ck_assert_int_eq(roman_big_add(&value, &value, &sum), ROMAN_ERR_OVERFLOW);
+END_TEST
+
+/*
+ * Tests for accumulators
+ */
+
+START_TEST(an_accumulator_sums_a_long_ledger)
+    roman_acc acc;
+    char *total;
+    char *expected_total = repeat_numeral("M", 1999, "");
+
+    int entry;
+
+    roman_acc_init(&acc);
+    for (entry = 0; entry < 1000; entry++) {
+        ck_assert_int_eq(roman_acc_add(&acc, "MCMXCIX"), ROMAN_OK);
+    }
+    ck_assert_int_eq(roman_acc_finish(&acc, &total), ROMAN_OK);
+    ck_assert_str_eq(total, expected_total);
+
+    free(total);
+    free(expected_total);
+END_TEST
+
+START_TEST(an_accumulator_may_go_negative_before_it_finishes)
+    roman_acc acc;
+    char *total;
+
+    roman_acc_init(&acc);
+    roman_acc_add(&acc, "XIV");
+    roman_acc_sub(&acc, "XL");
+    ck_assert_int_eq(roman_acc_finish(&acc, &total),
+                     ROMAN_ERR_NEGATIVE_RESULT);
+    ck_assert_ptr_eq(total, NULL);
+
+    roman_acc_add(&acc, "XXIX");
+    ck_assert_int_eq(roman_acc_finish(&acc, &total), ROMAN_OK);
+    ck_assert_str_eq(total, "III");
+    free(total);
+END_TEST
+
+START_TEST(an_accumulator_carries_counts_that_would_overflow)
+    roman_acc acc;
+    roman_big total;
+
+    roman_acc_init(&acc);
+    acc.character_counts[0] = INT64_MAX - 1;
+    ck_assert_int_eq(roman_acc_add(&acc, "I"), ROMAN_OK);
+    ck_assert_int_eq(roman_acc_add(&acc, "I"), ROMAN_OK);
+
+    /* 2^63 = 9223372036854775 * 1000 + 808 */
+    ck_assert_int_eq(roman_acc_finish_big(&acc, &total), ROMAN_OK);
+    ck_assert_uint_eq(total.thousands, 9223372036854775ULL);
+    ck_assert_uint_eq(roman_big_length(&total),
+                      9223372036854775ULL + strlen("DCCCVIII"));
+END_TEST
+
+START_TEST(an_accumulator_ignores_invalid_numerals)
+    roman_acc acc;
+    char *total;
+
+    roman_acc_init(&acc);
+    roman_acc_add(&acc, "VI");
+    ck_assert_int_eq(roman_acc_add(&acc, "IVX"), ROMAN_ERR_AMBIGUOUS_FORM);
+    ck_assert_int_eq(roman_acc_sub(&acc, ""), ROMAN_ERR_EMPTY_INPUT);
+    ck_assert_int_eq(roman_acc_finish(&acc, &total), ROMAN_OK);
+    ck_assert_str_eq(total, "VI");
+    free(total);
+END_TEST
+
+/*
+ * Tests for conversion between numerals and integers
+ */
+
+START_TEST(numerals_convert_to_their_values)
+    uint64_t value;
+
+    ck_assert_int_eq(roman_to_u64("MCMXC", &value), ROMAN_OK);
+    ck_assert_uint_eq(value, 1990);
+    ck_assert_int_eq(roman_to_u64("IC", &value), ROMAN_OK);
+    ck_assert_uint_eq(value, 101);
+    ck_assert_int_eq(roman_to_u64("LD", &value), ROMAN_OK);
+    ck_assert_uint_eq(value, 450);
+    ck_assert_int_eq(roman_to_u64("XIIX", &value), ROMAN_OK);
+    ck_assert_uint_eq(value, 20);
+END_TEST
+
+START_TEST(converting_invalid_numerals_fails)
+    uint64_t value;
+
+    ck_assert_int_eq(roman_to_u64("", &value), ROMAN_ERR_EMPTY_INPUT);
+    ck_assert_int_eq(roman_to_u64("XIQ", &value),
+                     ROMAN_ERR_INVALID_CHARACTER);
+    ck_assert_int_eq(roman_to_u64("IVX", &value), ROMAN_ERR_AMBIGUOUS_FORM);
+END_TEST
+
+START_TEST(values_convert_to_canonical_numerals)
+    char numeral[32];
+
+    ck_assert_uint_eq(u64_to_roman(1999, numeral, sizeof(numeral)), 7);
+    ck_assert_str_eq(numeral, "MCMXCIX");
+    ck_assert_uint_eq(u64_to_roman(0, numeral, sizeof(numeral)), 0);
+    ck_assert_str_eq(numeral, "");
+    ck_assert_uint_eq(roman_len_for(3888), 15);
+    ck_assert_uint_eq(roman_len_for(10000), 10);
+END_TEST
+
+START_TEST(values_that_do_not_fit_report_their_length)
+    char numeral[4] = "ZZZ";
+
+    ck_assert_uint_eq(u64_to_roman(3888, numeral, sizeof(numeral)), 15);
+    ck_assert_str_eq(numeral, "");
+    ck_assert_uint_eq(u64_to_roman(8, NULL, 0), 4);
+END_TEST
+
+START_TEST(conversions_round_trip)
+    char numeral[32];
+    uint64_t value;
+    uint64_t converted;
+
+    for (value = 0; value < 5000; value++) {
+        ck_assert_uint_eq(u64_to_roman(value, numeral, sizeof(numeral)),
+                          roman_len_for(value));
+        if (value == 0) continue;
+        ck_assert_int_eq(roman_to_u64(numeral, &converted), ROMAN_OK);
+        ck_assert_uint_eq(converted, value);
+    }
+END_TEST
+
+/*
+ * Tests for roman_validate
+ */
+
+START_TEST(strict_validation_accepts_canonical_numerals)
+    char numeral[32];
+
+    uint64_t value;
+    for (value = 1; value < 5000; value++) {
+        u64_to_roman(value, numeral, sizeof(numeral));
+        ck_assert_int_eq(roman_validate(numeral, ROMAN_STRICT), ROMAN_OK);
+    }
+END_TEST
+
+START_TEST(strict_validation_rejects_other_forms)
+    const char *non_canonical[] = {
+        "IIII", "VV", "IC", "XM", "XIIX", "VX", "MCMC", "CMM", "DD", "IXI",
+        "XCX", "CDC", "LXL", "IVI", "MDCCCC", "IIV"
+    };
+
+    size_t numeral;
+    for (numeral = 0; numeral < sizeof(non_canonical) / sizeof(char *);
+         numeral++) {
+        ck_assert_int_eq(roman_validate(non_canonical[numeral],
+                                        ROMAN_STRICT),
+                         ROMAN_ERR_NON_CANONICAL);
+    }
+    ck_assert_int_eq(roman_validate("", ROMAN_STRICT), ROMAN_ERR_EMPTY_INPUT);
+    ck_assert_int_eq(roman_validate("XIQ", ROMAN_STRICT),
+                     ROMAN_ERR_INVALID_CHARACTER);
+END_TEST
+
+/**
+ * Over every string of up to five Roman characters, strict validation must
+ * accept exactly the numerals that are their own canonical form, and lenient
+ * validation must agree with the arithmetic functions.
+ */
+START_TEST(validation_modes_agree_with_conversion_and_arithmetic)
+    const char characters[] = "IVXLCDM";
+    char numeral[6] = "";
+    char canonical[32];
+    int digits[5];
+    uint64_t value;
+    char *sum;
+    roman_status status;
+
+    size_t length;
+    size_t position;
+    for (length = 1; length <= 5; length++) {
+        memset(digits, 0, sizeof(digits));
+        numeral[length] = '\0';
+        for (;;) {
+            for (position = 0; position < length; position++) {
+                numeral[position] = characters[digits[position]];
+            }
+
+            status = roman_to_u64(numeral, &value);
+            u64_to_roman(value, canonical, sizeof(canonical));
+            ck_assert_int_eq(
+                roman_validate(numeral, ROMAN_STRICT) == ROMAN_OK,
+                status == ROMAN_OK && strcmp(numeral, canonical) == 0);
+
+            ck_assert_int_eq(roman_validate(numeral, ROMAN_LENIENT),
+                             roman_add(numeral, "I", &sum));
+            free(sum);
+
+            for (position = 0; position < length && digits[position] == 6;
+                 position++) {
+                digits[position] = 0;
+            }
+            if (position == length) break;
+            digits[position]++;
+        }
+    }
+END_TEST
+
+/*
+ * Tests for multiplication and division
+ */
+
+START_TEST(products_are_rendered_canonically)
+    char *product;
+
+    product = multiply_roman_numerals("XII", "XII");
+    ck_assert_str_eq(product, "CXLIV");
+    free(product);
+    product = multiply_roman_numerals("MCMXC", "II");
+    ck_assert_str_eq(product, "MMMCMLXXX");
+    free(product);
+    product = multiply_roman_numerals("IIII", "VIIII");
+    ck_assert_str_eq(product, "XXXVI");
+    free(product);
+    ck_assert_ptr_eq(multiply_roman_numerals("IVX", "I"), NULL);
+END_TEST
+
+START_TEST(quotients_and_remainders_are_rendered_canonically)
+    char *quotient;
+    char *remainder;
+
+    quotient = divide_roman_numerals("MMXXIV", "XII", &remainder);
+    ck_assert_str_eq(quotient, "CLXVIII");
+    ck_assert_str_eq(remainder, "VIII");
+    free(quotient);
+    free(remainder);
+
+    quotient = divide_roman_numerals("MMXXIV", "XXIII", &remainder);
+    ck_assert_str_eq(quotient, "LXXXVIII");
+    ck_assert_str_eq(remainder, "");
+    free(quotient);
+    free(remainder);
+
+    quotient = divide_roman_numerals("IX", "X", NULL);
+    ck_assert_str_eq(quotient, "");
+    free(quotient);
+
+    ck_assert_ptr_eq(divide_roman_numerals("X", "Q", &remainder), NULL);
+    ck_assert_ptr_eq(remainder, NULL);
+END_TEST
+
+/** Check every pair of factors up to a bound against integer arithmetic. */
+START_TEST(multiplication_and_division_agree_with_integers)
+    char numeral1[32];
+    char numeral2[32];
+    char *product;
+    char *quotient;
+    char *remainder;
+    uint64_t value;
+
+    uint64_t value1;
+    uint64_t value2;
+
+    for (value1 = 1; value1 <= 200; value1++) {
+        u64_to_roman(value1 * 13, numeral1, sizeof(numeral1));
+        for (value2 = 1; value2 <= 200; value2++) {
+            u64_to_roman(value2 * 3, numeral2, sizeof(numeral2));
+
+            ck_assert_int_eq(roman_multiply(numeral1, numeral2, &product),
+                             ROMAN_OK);
+            ck_assert_int_eq(roman_to_u64(product, &value), ROMAN_OK);
+            ck_assert_uint_eq(value, value1 * 13 * value2 * 3);
+            ck_assert_uint_eq(strlen(product),
+                              roman_len_for(value1 * 13 * value2 * 3));
+            free(product);
+
+            ck_assert_int_eq(roman_divide(numeral1, numeral2, &quotient,
+                                          &remainder), ROMAN_OK);
+            value = 0;
+            if (*quotient) roman_to_u64(quotient, &value);
+            ck_assert_uint_eq(value, (value1 * 13) / (value2 * 3));
+            value = 0;
+            if (*remainder) roman_to_u64(remainder, &value);
+            ck_assert_uint_eq(value, (value1 * 13) % (value2 * 3));
+            free(quotient);
+            free(remainder);
+        }
+    }
+END_TEST
+
+START_TEST(products_too_long_to_be_numerals_overflow)
+    char *thousands = repeat_numeral("M", 20000, "");
+    char *product;
+
+    ck_assert_int_eq(roman_multiply(thousands, thousands, &product),
+                     ROMAN_ERR_OVERFLOW);
+    ck_assert_ptr_eq(product, NULL);
+    free(thousands);
+END_TEST
+
+/*
+ * Tests for comparison and sorting
+ */
+
+START_TEST(numerals_are_compared_by_value)
+    int order;
+
+    ck_assert_int_eq(roman_compare("MCMXC", "MMXXIV", &order), ROMAN_OK);
+    ck_assert_int_lt(order, 0);
+    ck_assert_int_eq(roman_compare("IIII", "IV", &order), ROMAN_OK);
+    ck_assert_int_eq(order, 0);
+    ck_assert_int_eq(roman_compare("M", "CMXCIX", &order), ROMAN_OK);
+    ck_assert_int_gt(order, 0);
+    ck_assert_int_eq(roman_compare("X", "IVX", &order),
+                     ROMAN_ERR_AMBIGUOUS_FORM);
+END_TEST
+
+START_TEST(sorting_puts_invalid_numerals_last)
+    const char *numerals[] = {"X", "Q", "IX", "MM", "", "IIII", "IV", "I"};
+    size_t number_valid;
+
+    ck_assert_int_eq(roman_sort(numerals, 8, &number_valid), ROMAN_OK);
+    ck_assert_uint_eq(number_valid, 6);
+    ck_assert_str_eq(numerals[0], "I");
+    ck_assert_str_eq(numerals[1], "IIII");
+    ck_assert_str_eq(numerals[2], "IV");
+    ck_assert_str_eq(numerals[3], "IX");
+    ck_assert_str_eq(numerals[4], "X");
+    ck_assert_str_eq(numerals[5], "MM");
+    ck_assert_str_eq(numerals[6], "Q");
+    ck_assert_str_eq(numerals[7], "");
+END_TEST
+
+/**
+ * Sort numerals of random values, some of them with long runs of 'M' so that
+ * every byte of the keys is sorted on, and check their order.
+ */
+START_TEST(sorting_agrees_with_comparison)
+    char *storage = malloc(3000 * 64);
+    const char *numerals[3000];
+    uint64_t value;
+    int order;
+
+    size_t index;
+
+    srand(23);
+    for (index = 0; index < 3000; index++) {
+        value = (uint64_t)rand() % 4000 + 1;
+        if (index % 3 == 0) value += (uint64_t)(rand() % 40) * 1000;
+        u64_to_roman(value, storage + index * 64, 64);
+        numerals[index] = storage + index * 64;
+    }
+
+    ck_assert_int_eq(roman_sort(numerals, 3000, NULL), ROMAN_OK);
+    for (index = 1; index < 3000; index++) {
+        ck_assert_int_eq(roman_compare(numerals[index - 1], numerals[index],
+                                       &order), ROMAN_OK);
+        ck_assert_int_le(order, 0);
+    }
+    free(storage);
+END_TEST
+
+/** The size of the scratch space would overflow, so nothing is touched. */
+START_TEST(sorting_reports_counts_too_large_to_allocate)
+    const char *numeral = "I";
+
+    ck_assert_int_eq(roman_sort(&numeral, (size_t)-1 / 2, NULL),
+                     ROMAN_ERR_OUT_OF_MEMORY);
+END_TEST
+
+/*
+ * Tests for roman_decode_column
+ */
+
+START_TEST(a_column_is_decoded_entry_by_entry)
+    const char data[] = "MCMXCIIIIIVXMMQXIC";
+    const size_t offsets[] = {0, 5, 9, 9, 12, 15, 18};
+    uint64_t values[6];
+    roman_status statuses[6];
+
+    ck_assert_uint_eq(roman_decode_column(data, offsets, 6, ROMAN_LENIENT,
+                                          values, statuses), 3);
+    ck_assert_int_eq(statuses[0], ROMAN_OK);
+    ck_assert_uint_eq(values[0], 1990);
+    ck_assert_int_eq(statuses[1], ROMAN_OK);
+    ck_assert_uint_eq(values[1], 4);
+    ck_assert_int_eq(statuses[2], ROMAN_ERR_EMPTY_INPUT);
+    ck_assert_int_eq(statuses[3], ROMAN_ERR_AMBIGUOUS_FORM);
+    ck_assert_int_eq(statuses[4], ROMAN_ERR_INVALID_CHARACTER);
+    ck_assert_int_eq(statuses[5], ROMAN_OK);
+    ck_assert_uint_eq(values[5], 111);
+
+    ck_assert_uint_eq(roman_decode_column(data, offsets, 6, ROMAN_STRICT,
+                                          values, statuses), 1);
+    ck_assert_int_eq(statuses[1], ROMAN_ERR_NON_CANONICAL);
+    ck_assert_int_eq(statuses[5], ROMAN_ERR_NON_CANONICAL);
+END_TEST
+
+/**
+ * Decode a column of random entries, some long enough to be scanned with
+ * vector instructions and some with a stray byte, and compare each with
+ * roman_to_u64 and roman_validate.
+ */
+START_TEST(column_decoding_agrees_with_single_numerals)
+    const char characters[] = "IVXLCDM";
+    char data[2000 * 80];
+    size_t offsets[2001];
+    uint64_t values[2000];
+    roman_status statuses[2000];
+    char numeral[81];
+    uint64_t value;
+    roman_status status;
+    size_t length;
+    int mode;
+
+    size_t entry;
+    size_t position;
+
+    srand(2024);
+    offsets[0] = 0;
+    for (entry = 0; entry < 2000; entry++) {
+        length = (size_t)rand() % ((entry % 4 == 0) ? 80 : 8);
+        for (position = 0; position < length; position++) {
+            data[offsets[entry] + position]
+                = (rand() % 500 == 0) ? '?' : characters[rand() % 7];
+        }
+        offsets[entry + 1] = offsets[entry] + length;
+    }
+
+    for (mode = ROMAN_LENIENT; mode <= ROMAN_STRICT; mode++) {
+        roman_decode_column(data, offsets, 2000, (roman_validation)mode,
+                            values, statuses);
+        for (entry = 0; entry < 2000; entry++) {
+            length = offsets[entry + 1] - offsets[entry];
+            memcpy(numeral, data + offsets[entry], length);
+            numeral[length] = '\0';
+
+            status = (mode == ROMAN_STRICT)
+                     ? roman_validate(numeral, ROMAN_STRICT) : ROMAN_OK;
+            if (status == ROMAN_OK) status = roman_to_u64(numeral, &value);
+            ck_assert_int_eq(statuses[entry], status);
+            if (status == ROMAN_OK) ck_assert_uint_eq(values[entry], value);
+        }
+    }
+END_TEST
+
+/*
+ * Tests for arenas
+ */
+
+START_TEST(arena_results_stay_valid_until_reset)
+    roman_arena *arena = roman_arena_create(16);
+    char *long_summand = repeat_numeral("M", 100, "");
+    const char *results[40];
+    const char *first_result;
+
+    int result;
+
+    for (result = 0; result < 40; result += 2) {
+        ck_assert_int_eq(roman_arena_add(arena, "MCMXC", "XLII",
+                                         &results[result]), ROMAN_OK);
+        ck_assert_int_eq(roman_arena_subtract(arena, "MCMXC", "XLII",
+                                              &results[result + 1]),
+                         ROMAN_OK);
+    }
+    ck_assert_int_eq(roman_arena_add(arena, long_summand, "I", &first_result),
+                     ROMAN_OK);
+    ck_assert_uint_eq(strlen(first_result), 101);
+
+    for (result = 0; result < 40; result += 2) {
+        ck_assert_str_eq(results[result], "MMXXXII");
+        ck_assert_str_eq(results[result + 1], "MCMXLVIII");
+    }
+
+    roman_arena_reset(arena);
+    ck_assert_int_eq(roman_arena_add(arena, "I", "I", &first_result),
+                     ROMAN_OK);
+    ck_assert_ptr_eq(first_result, results[0]);
+    ck_assert_str_eq(first_result, "II");
+
+    free(long_summand);
+    roman_arena_destroy(arena);
+END_TEST
+
+START_TEST(arena_failures_report_their_status)
+    roman_arena *arena = roman_arena_create(0);
+    const char *result;
+
+    ck_assert_int_eq(roman_arena_add(arena, "IVX", "I", &result),
+                     ROMAN_ERR_AMBIGUOUS_FORM);
+    ck_assert_ptr_eq(result, NULL);
+    ck_assert_int_eq(roman_arena_subtract(arena, "I", "II", &result),
+                     ROMAN_ERR_NEGATIVE_RESULT);
+    ck_assert_ptr_eq(result, NULL);
+
+    roman_arena_destroy(arena);
+END_TEST
+
+/*
+ * Tests for the result cache
+ */
+
+START_TEST(a_cache_shares_results_of_repeated_pairs)
+    roman_cache *cache = roman_cache_create(64);
+    roman_cache_stats stats;
+    const char *sum1;
+    const char *sum2;
+    const char *difference;
+
+    ck_assert_int_eq(roman_cache_add(cache, "MCMXC", "XLII", &sum1), ROMAN_OK);
+    ck_assert_int_eq(roman_cache_add(cache, "MCMXC", "XLII", &sum2), ROMAN_OK);
+    ck_assert_str_eq(sum1, "MMXXXII");
+    ck_assert_ptr_eq(sum1, sum2);
+    ck_assert_int_eq(roman_cache_subtract(cache, "MCMXC", "XLII",
+                                          &difference), ROMAN_OK);
+    ck_assert_str_eq(difference, "MCMXLVIII");
+
+    roman_cache_get_stats(cache, &stats);
+    ck_assert_uint_eq(stats.hits, 1);
+    ck_assert_uint_eq(stats.misses, 2);
+
+    roman_cache_release(sum1);
+    roman_cache_release(sum2);
+    roman_cache_release(difference);
+    roman_cache_destroy(cache);
+END_TEST
+
+START_TEST(a_cache_remembers_failures)
+    roman_cache *cache = roman_cache_create(64);
+    roman_cache_stats stats;
+    const char *difference;
+
+    ck_assert_int_eq(roman_cache_subtract(cache, "I", "II", &difference),
+                     ROMAN_ERR_NEGATIVE_RESULT);
+    ck_assert_ptr_eq(difference, NULL);
+    ck_assert_int_eq(roman_cache_subtract(cache, "I", "II", &difference),
+                     ROMAN_ERR_NEGATIVE_RESULT);
+    ck_assert_int_eq(roman_cache_add(cache, "IVX", "I", &difference),
+                     ROMAN_ERR_AMBIGUOUS_FORM);
+
+    roman_cache_get_stats(cache, &stats);
+    ck_assert_uint_eq(stats.hits, 1);
+    roman_cache_destroy(cache);
+END_TEST
+
+START_TEST(cached_results_outlive_eviction_and_the_cache)
+    roman_cache *cache = roman_cache_create(1);
+    roman_cache_stats stats;
+    const char *first_sum;
+    const char *sum;
+    char numeral[32];
+
+    int value;
+
+    roman_cache_add(cache, "MM", "I", &first_sum);
+    for (value = 1; value < 500; value++) {
+        u64_to_roman(value, numeral, sizeof(numeral));
+        ck_assert_int_eq(roman_cache_add(cache, numeral, numeral, &sum),
+                         ROMAN_OK);
+        roman_cache_release(sum);
+    }
+
+    roman_cache_get_stats(cache, &stats);
+    ck_assert_uint_gt(stats.evictions, 0);
+    roman_cache_destroy(cache);
+    ck_assert_str_eq(first_sum, "MMI");
+    roman_cache_release(first_sum);
+END_TEST
+
+/*
+ * Tests for allocator hooks and instrumentation counters
+ */
+
+START_TEST(allocations_go_through_the_installed_allocator)
+    allocation_counts counts = {0, 0};
+    roman_allocator allocator;
+    roman_ctx *ctx;
+    const char *difference;
+    char *sum;
+
+    allocator.allocate = counting_allocate;
+    allocator.reallocate = counting_reallocate;
+    allocator.release = counting_release;
+    allocator.context = &counts;
+    roman_set_allocator(&allocator);
+
+    ck_assert_int_eq(roman_add("MCMXC", "XLII", &sum), ROMAN_OK);
+    ck_assert_str_eq(sum, "MMXXXII");
+    ctx = roman_ctx_create();
+    ck_assert_int_eq(roman_ctx_subtract(ctx, "MCMXC", "XLII", &difference),
+                     ROMAN_OK);
+    ck_assert_str_eq(difference, "MCMXLVIII");
+    ck_assert_uint_eq(counts.allocations, 3);
+
+    roman_free(sum);
+    roman_ctx_destroy(ctx);
+    ck_assert_uint_eq(counts.releases, 3);
+
+    roman_set_allocator(NULL);
+    sum = add_roman_numerals("I", "I");
+    ck_assert_uint_eq(counts.allocations, 3);
+    roman_free(sum);
+    ck_assert_uint_eq(counts.releases, 3);
+END_TEST
+
+START_TEST(counters_record_what_the_calling_thread_did)
+    roman_counters counters;
+    char *sum;
+    char *difference;
+    char *invalid_sum;
+
+    roman_reset_counters();
+    ck_assert_int_eq(roman_add("XVIII", "II", &sum), ROMAN_OK);
+    ck_assert_int_eq(roman_subtract("X", "I", &difference), ROMAN_OK);
+    ck_assert_int_eq(roman_add("Q", "I", &invalid_sum),
+                     ROMAN_ERR_INVALID_CHARACTER);
+    ck_assert_int_eq(roman_validate("IIII", ROMAN_STRICT),
+                     ROMAN_ERR_NON_CANONICAL);
+    roman_get_counters(&counters);
+
+#ifdef ROMAN_INSTRUMENTATION
+    ck_assert_uint_eq(counters.calls, 3);
+    ck_assert_uint_eq(counters.allocations, 2);
+    ck_assert_uint_eq(counters.bytes_allocated, 6);
+    ck_assert_uint_eq(counters.bytes_rendered, 4);
+    ck_assert_uint_eq(counters.carries, 3);
+    ck_assert_uint_eq(counters.borrows, 1);
+    ck_assert_uint_eq(counters.multi_step_borrows, 0);
+    ck_assert_uint_eq(counters.validation_failures, 2);
+#else
+    ck_assert_uint_eq(counters.calls, 0);
+    ck_assert_uint_eq(counters.allocations, 0);
+    ck_assert_uint_eq(counters.validation_failures, 0);
+#endif
+
+    ck_assert_str_eq(sum, "XX");
+    ck_assert_str_eq(difference, "IX");
+    ck_assert_ptr_eq(invalid_sum, NULL);
+    roman_free(sum);
+    roman_free(difference);
+    roman_free(invalid_sum);
+END_TEST
+
+/*
+ * Tests for length-delimited input
+ */
+
+/**
+ * Every numeral is read from an exactly sized copy of a packet with no '\0'
+ * anywhere in it, so reading past a numeral is caught by memory checkers.
+ */
+START_TEST(numerals_are_read_from_slices_of_a_larger_buffer)
+    const char text[] = "XIV+XIII MCMXC-X";
+    char *packet = malloc(strlen(text));
+    char out[16];
+    char *sum;
+    char *difference;
+    char *product;
+    char *quotient;
+    char *remainder;
+    char *total;
+    const char *result;
+    roman_ctx *ctx = roman_ctx_create();
+    roman_arena *arena = roman_arena_create(0);
+    roman_cache *cache = roman_cache_create(16);
+    roman_status status;
+    roman_big big;
+    roman_acc acc;
+    uint64_t value;
+    size_t length;
+    int order;
+
+    memcpy(packet, text, strlen(text));
+
+    ck_assert_int_eq(roman_add_n(packet, 3, packet + 4, 4, &sum), ROMAN_OK);
+    ck_assert_str_eq(sum, "XXVII");
+    ck_assert_int_eq(roman_subtract_n(packet + 9, 5, packet + 15, 1,
+                                      &difference), ROMAN_OK);
+    ck_assert_str_eq(difference, "MCMLXXX");
+    ck_assert_uint_eq(add_roman_numerals_into_n(packet, 3, packet + 4, 4,
+                                                out, sizeof(out), &status),
+                      5);
+    ck_assert_int_eq(status, ROMAN_OK);
+    ck_assert_str_eq(out, "XXVII");
+    ck_assert_int_eq(roman_subtract_length_n(packet + 9, 5, packet + 15, 1,
+                                             &length), ROMAN_OK);
+    ck_assert_uint_eq(length, 7);
+
+    ck_assert_int_eq(roman_multiply_n(packet, 3, packet + 15, 1, &product),
+                     ROMAN_OK);
+    ck_assert_str_eq(product, "CXL");
+    ck_assert_int_eq(roman_divide_n(packet + 9, 5, packet, 3, &quotient,
+                                    &remainder), ROMAN_OK);
+    ck_assert_str_eq(quotient, "CXLII");
+    ck_assert_str_eq(remainder, "II");
+
+    ck_assert_int_eq(roman_to_u64_n(packet + 9, 5, &value), ROMAN_OK);
+    ck_assert_uint_eq(value, 1990);
+    ck_assert_int_eq(roman_compare_n(packet, 3, packet + 4, 4, &order),
+                     ROMAN_OK);
+    ck_assert_int_gt(order, 0);
+    ck_assert_int_eq(roman_validate_n(packet + 9, 5, ROMAN_STRICT), ROMAN_OK);
+
+    ck_assert_int_eq(roman_ctx_add_n(ctx, packet, 3, packet + 4, 4, &result),
+                     ROMAN_OK);
+    ck_assert_str_eq(result, "XXVII");
+    ck_assert_int_eq(roman_arena_subtract_n(arena, packet + 9, 5,
+                                            packet + 15, 1, &result),
+                     ROMAN_OK);
+    ck_assert_str_eq(result, "MCMLXXX");
+    ck_assert_int_eq(roman_cache_add_n(cache, packet, 3, packet + 4, 4,
+                                       &result), ROMAN_OK);
+    ck_assert_str_eq(result, "XXVII");
+    roman_cache_release(result);
+
+    ck_assert_int_eq(roman_big_parse_n(packet + 9, 5, &big), ROMAN_OK);
+    assert_big_numeral_equals(&big, "MCMXC");
+    roman_acc_init(&acc);
+    ck_assert_int_eq(roman_acc_add_n(&acc, packet, 3), ROMAN_OK);
+    ck_assert_int_eq(roman_acc_sub_n(&acc, packet + 15, 1), ROMAN_OK);
+    ck_assert_int_eq(roman_acc_finish(&acc, &total), ROMAN_OK);
+    ck_assert_str_eq(total, "IV");
+
+    free(sum);
+    free(difference);
+    free(product);
+    free(quotient);
+    free(remainder);
+    free(total);
+    roman_ctx_destroy(ctx);
+    roman_arena_destroy(arena);
+    roman_cache_destroy(cache);
+    free(packet);
+END_TEST
+
+START_TEST(a_nul_byte_inside_a_slice_is_an_invalid_character)
+    const char numeral[] = {'X', '\0', 'I'};
+    char *sum;
+    uint64_t value;
+
+    ck_assert_int_eq(roman_add_n(numeral, 3, "I", 1, &sum),
+                     ROMAN_ERR_INVALID_CHARACTER);
+    ck_assert_int_eq(roman_to_u64_n(numeral, 3, &value),
+                     ROMAN_ERR_INVALID_CHARACTER);
+    ck_assert_int_eq(roman_validate_n(numeral, 3, ROMAN_LENIENT),
+                     ROMAN_ERR_INVALID_CHARACTER);
+    ck_assert_int_eq(roman_validate_n(numeral, 3, ROMAN_STRICT),
+                     ROMAN_ERR_INVALID_CHARACTER);
+
+    ck_assert_int_eq(roman_add_n(numeral, 0, "I", 1, &sum),
+                     ROMAN_ERR_EMPTY_INPUT);
+    ck_assert_int_eq(roman_to_u64_n(numeral, 0, &value),
+                     ROMAN_ERR_EMPTY_INPUT);
+    ck_assert_int_eq(roman_validate_n(numeral, 0, ROMAN_STRICT),
+                     ROMAN_ERR_EMPTY_INPUT);
+
+    ck_assert_int_eq(roman_add_n(numeral, 1, "I", 1, &sum), ROMAN_OK);
+    ck_assert_str_eq(sum, "XI");
+    free(sum);
+END_TEST
+
+/**
+ * Random numerals, some with a stray character and some long enough to be
+ * counted with vector instructions, give the same results either way.
+ */
+START_TEST(length_delimited_functions_agree_with_string_functions)
+    const char characters[] = "IVXLCDMQ";
+    char numerals[2][81];
+    char *slices[2];
+    size_t lengths[2];
+    char *expected;
+    char *actual;
+    uint64_t expected_value;
+    uint64_t actual_value;
+    int mode;
+
+    int trial;
+    int which;
+    size_t position;
+
+    srand(1066);
+    for (trial = 0; trial < 2000; trial++) {
+        for (which = 0; which < 2; which++) {
+            lengths[which] = (rand() % 4 == 0) ? 65 + rand() % 16
+                                               : rand() % 12;
+            for (position = 0; position < lengths[which]; position++) {
+                numerals[which][position]
+                    = characters[rand() % ((rand() % 8 == 0) ? 8 : 7)];
+            }
+            numerals[which][lengths[which]] = '\0';
+            /* A Roman character after the slice would change the result. */
+            slices[which] = malloc(lengths[which] + 1);
+            memcpy(slices[which], numerals[which], lengths[which]);
+            slices[which][lengths[which]] = 'I';
+        }
+
+        ck_assert_int_eq(roman_add_n(slices[0], lengths[0], slices[1],
+                                     lengths[1], &actual),
+                         roman_add(numerals[0], numerals[1], &expected));
+        if (expected) ck_assert_str_eq(actual, expected);
+        free(expected);
+        free(actual);
+
+        ck_assert_int_eq(roman_subtract_n(slices[0], lengths[0], slices[1],
+                                          lengths[1], &actual),
+                         roman_subtract(numerals[0], numerals[1],
+                                        &expected));
+        if (expected) ck_assert_str_eq(actual, expected);
+        free(expected);
+        free(actual);
+
+        ck_assert_int_eq(roman_to_u64_n(slices[0], lengths[0],
+                                        &actual_value),
+                         roman_to_u64(numerals[0], &expected_value));
+        ck_assert_uint_eq(actual_value, expected_value);
+        for (mode = ROMAN_LENIENT; mode <= ROMAN_STRICT; mode++) {
+            ck_assert_int_eq(roman_validate_n(slices[0], lengths[0],
+                                              (roman_validation)mode),
+                             roman_validate(numerals[0],
+                                            (roman_validation)mode));
+        }
+
+        free(slices[0]);
+        free(slices[1]);
+    }
+END_TEST
+
 static void assert_sum_equals(const char *summand1, const char *summand2,
                               const char *expected_sum)
 {
@@ -169,12 +1345,112 @@ static void assert_difference_equals(const char *numeral1, const char *numeral2,
     free(difference);
 }
 
+static void assert_sum_fails(const char *summand1, const char *summand2,
+                             roman_status expected_status)
+{
+    char *sum;
+    ck_assert_int_eq(roman_add(summand1, summand2, &sum), expected_status);
+    ck_assert_ptr_eq(sum, NULL);
+}
+
+static void assert_difference_fails(const char *numeral1, const char *numeral2,
+                                    roman_status expected_status)
+{
+    char *difference;
+    ck_assert_int_eq(roman_subtract(numeral1, numeral2, &difference),
+                     expected_status);
+    ck_assert_ptr_eq(difference, NULL);
+}
+
+static char *repeat_numeral(const char *numeral, size_t copies,
+                            const char *suffix)
+{
+    size_t numeral_length = strlen(numeral);
+    char *result = malloc(numeral_length * copies + strlen(suffix) + 1);
+
+    size_t copy;
+    for (copy = 0; copy < copies; copy++) {
+        memcpy(result + copy * numeral_length, numeral, numeral_length);
+    }
+    strcpy(result + copies * numeral_length, suffix);
+    return result;
+}
+
+static void assert_big_numeral_equals(const roman_big *value,
+                                      const char *expected_numeral)
+{
+    char *numeral;
+    ck_assert_int_eq(roman_big_to_string(value, &numeral), ROMAN_OK);
+    ck_assert_str_eq(numeral, expected_numeral);
+    free(numeral);
+}
+
+/** Counts the 'M' characters and the other characters written. */
+static int count_written_characters(void *context, const char *bytes,
+                                    size_t length)
+{
+    size_t *written = context;
+
+    size_t offset;
+    for (offset = 0; offset < length; offset++) {
+        written[(bytes[offset] == 'M') ? 0 : 1]++;
+    }
+    return 0;
+}
+
+/** Appends what is written to the '\0'-terminated string in context. */
+static int append_written_bytes(void *context, const char *bytes,
+                                size_t length)
+{
+    char *written = context;
+    size_t written_length = strlen(written);
+
+    memcpy(written + written_length, bytes, length);
+    written[written_length + length] = '\0';
+    return 0;
+}
+
+static void *counting_allocate(size_t size, void *context)
+{
+    ((allocation_counts *)context)->allocations++;
+    return malloc(size);
+}
+
+static void *counting_reallocate(void *pointer, size_t size, void *context)
+{
+    ((allocation_counts *)context)->allocations++;
+    return realloc(pointer, size);
+}
+
+static void counting_release(void *pointer, void *context)
+{
+    ((allocation_counts *)context)->releases++;
+    free(pointer);
+}
+
 Suite *create_calculator_test_suite(void)
 {
     Suite *test_suite = suite_create("Roman_Calculator");
 
     TCase *addition_test_case = tcase_create("Addition");
     TCase *subtraction_test_case = tcase_create("Subtraction");
+    TCase *buffer_test_case = tcase_create("Caller_Provided_Buffers");
+    TCase *batch_test_case = tcase_create("Batches");
+    TCase *long_numeral_test_case = tcase_create("Long_Numerals");
+    TCase *context_test_case = tcase_create("Scratch_Contexts");
+    TCase *big_numeral_test_case = tcase_create("Big_Numerals");
+    TCase *accumulator_test_case = tcase_create("Accumulators");
+    TCase *conversion_test_case = tcase_create("Conversions");
+    TCase *validation_test_case = tcase_create("Validation");
+    TCase *multiplication_test_case
+        = tcase_create("Multiplication_And_Division");
+    TCase *sorting_test_case = tcase_create("Comparison_And_Sorting");
+    TCase *column_test_case = tcase_create("Columns");
+    TCase *arena_test_case = tcase_create("Arenas");
+    TCase *cache_test_case = tcase_create("Caches");
+    TCase *hook_test_case = tcase_create("Hooks");
+    TCase *length_delimited_test_case
+        = tcase_create("Length_Delimited_Input");
 
     /*
      * Populate addition test case
@@ -192,27 +1468,26 @@ Suite *create_calculator_test_suite(void)
     tcase_add_test(addition_test_case, sum_of_IV_and_I_is_V);
     tcase_add_test(addition_test_case, sum_of_IX_and_I_is_X);
     tcase_add_test(addition_test_case, sum_of_XC_and_X_is_C);
-    tcase_add_exit_test(
-        addition_test_case,
-        add_roman_numerals_exits_with_a_failure_state_when_first_argument_is_malformed,
-        EXIT_FAILURE
-    );
-    tcase_add_exit_test(
+    tcase_add_test(
         addition_test_case,
-        add_roman_numerals_exits_with_a_failure_state_when_second_argument_is_malformed,
-        EXIT_FAILURE
+        add_roman_numerals_returns_null_when_first_argument_is_malformed
     );
-    tcase_add_exit_test(
+    tcase_add_test(
         addition_test_case,
-        empty_addition_input_strings_result_in_failure,
-        EXIT_FAILURE
+        add_roman_numerals_returns_null_when_second_argument_is_malformed
     );
+    tcase_add_test(addition_test_case,
+                   empty_addition_input_strings_result_in_failure);
+    tcase_add_test(addition_test_case, roman_add_reports_invalid_characters);
+    tcase_add_test(addition_test_case, roman_add_reports_ambiguous_numerals);
     tcase_add_test(addition_test_case, sum_of_I_and_XLI_is_XLII);
     tcase_add_test(
         addition_test_case,
         add_roman_numerals_accepts_input_greater_than_3999
     );
     tcase_add_test(addition_test_case, sum_of_MMD_and_MMD_is_MMMMM);
+    tcase_add_test(addition_test_case,
+                   sum_of_MMMDCCCLXXXVII_and_I_is_MMMDCCCLXXXVIII);
 
     /*
      * Populate subtraction test case
@@ -230,11 +1505,16 @@ Suite *create_calculator_test_suite(void)
         subtraction_test_case,
         borrowing_is_performed_correctly_when_subtracting_one_roman_char_from_another
     );
-    tcase_add_exit_test(
+    tcase_add_test(
         subtraction_test_case,
-        subtract_roman_numerals_rejects_non_Roman_numeral_input,
-        EXIT_FAILURE
+        subtract_roman_numerals_rejects_non_Roman_numeral_input
     );
+    tcase_add_test(subtraction_test_case,
+                   roman_subtract_reports_negative_results);
+    tcase_add_test(subtraction_test_case,
+                   borrowing_handles_long_additive_subtrahends);
+    tcase_add_test(subtraction_test_case,
+                   borrowing_handles_long_additive_minuends);
     tcase_add_test(subtraction_test_case, IX_minus_V_is_IV);
     tcase_add_test(subtraction_test_case, XV_minus_IX_equals_VI);
     tcase_add_test(
@@ -243,8 +1523,172 @@ Suite *create_calculator_test_suite(void)
     );
     tcase_add_test(subtraction_test_case, MMMMM_minus_MMC_equals_MMCM);
 
+    /*
+     * Populate caller-provided buffer test case
+     */
+    tcase_add_test(buffer_test_case,
+                   add_roman_numerals_into_writes_sum_into_buffer);
+    tcase_add_test(buffer_test_case,
+                   subtract_roman_numerals_into_writes_difference_into_buffer);
+    tcase_add_test(
+        buffer_test_case,
+        into_variants_report_needed_length_when_buffer_is_too_small
+    );
+    tcase_add_test(buffer_test_case,
+                   into_variants_report_invalid_input_through_status);
+    tcase_add_test(buffer_test_case, exact_lengths_match_rendered_results);
+
+    /*
+     * Populate batch test case
+     */
+    tcase_add_test(batch_test_case, roman_add_batch_packs_sums_into_the_arena);
+    tcase_add_test(
+        batch_test_case,
+        roman_subtract_batch_flags_malformed_pairs_without_exiting
+    );
+    tcase_add_test(batch_test_case, batch_results_that_do_not_fit_are_flagged);
+
+    /*
+     * Populate long numeral test case
+     */
+    tcase_add_test(long_numeral_test_case,
+                   sum_of_long_numerals_carries_into_the_M_run);
+    tcase_add_test(long_numeral_test_case,
+                   long_numerals_are_checked_for_invalid_characters);
+    tcase_add_test(long_numeral_test_case,
+                   long_numerals_are_checked_for_ambiguous_forms);
+
+    /*
+     * Populate scratch context test case
+     */
+    tcase_add_test(context_test_case,
+                   a_context_is_reused_for_growing_results);
+    tcase_add_test(context_test_case, a_context_reports_invalid_input);
+    tcase_add_test(context_test_case, a_context_evaluates_expressions);
+    tcase_add_test(context_test_case,
+                   many_lines_are_evaluated_in_order_on_several_threads);
+
+    /*
+     * Populate big numeral test case
+     */
+    tcase_add_test(big_numeral_test_case,
+                   big_numerals_round_trip_through_strings);
+    tcase_add_test(big_numeral_test_case,
+                   big_numerals_can_be_added_and_subtracted);
+    tcase_add_test(big_numeral_test_case,
+                   huge_big_numerals_are_written_in_chunks);
+    tcase_add_test(big_numeral_test_case,
+                   adding_big_numerals_reports_overflow);
+
+    /*
+     * Populate accumulator test case
+     */
+    tcase_add_test(accumulator_test_case, an_accumulator_sums_a_long_ledger);
+    tcase_add_test(accumulator_test_case,
+                   an_accumulator_may_go_negative_before_it_finishes);
+    tcase_add_test(accumulator_test_case,
+                   an_accumulator_carries_counts_that_would_overflow);
+    tcase_add_test(accumulator_test_case,
+                   an_accumulator_ignores_invalid_numerals);
+
+    /*
+     * Populate conversion test case
+     */
+    tcase_add_test(conversion_test_case, numerals_convert_to_their_values);
+    tcase_add_test(conversion_test_case, converting_invalid_numerals_fails);
+    tcase_add_test(conversion_test_case,
+                   values_convert_to_canonical_numerals);
+    tcase_add_test(conversion_test_case,
+                   values_that_do_not_fit_report_their_length);
+    tcase_add_test(conversion_test_case, conversions_round_trip);
+
+    /*
+     * Populate validation test case
+     */
+    tcase_add_test(validation_test_case,
+                   strict_validation_accepts_canonical_numerals);
+    tcase_add_test(validation_test_case,
+                   strict_validation_rejects_other_forms);
+    tcase_add_test(validation_test_case,
+                   validation_modes_agree_with_conversion_and_arithmetic);
+
+    /*
+     * Populate multiplication and division test case
+     */
+    tcase_add_test(multiplication_test_case,
+                   products_are_rendered_canonically);
+    tcase_add_test(multiplication_test_case,
+                   quotients_and_remainders_are_rendered_canonically);
+    tcase_add_test(multiplication_test_case,
+                   multiplication_and_division_agree_with_integers);
+    tcase_add_test(multiplication_test_case,
+                   products_too_long_to_be_numerals_overflow);
+
+    /*
+     * Populate comparison and sorting test case
+     */
+    tcase_add_test(sorting_test_case, numerals_are_compared_by_value);
+    tcase_add_test(sorting_test_case, sorting_puts_invalid_numerals_last);
+    tcase_add_test(sorting_test_case, sorting_agrees_with_comparison);
+    tcase_add_test(sorting_test_case,
+                   sorting_reports_counts_too_large_to_allocate);
+
+    /*
+     * Populate column test case
+     */
+    tcase_add_test(column_test_case, a_column_is_decoded_entry_by_entry);
+    tcase_add_test(column_test_case,
+                   column_decoding_agrees_with_single_numerals);
+
+    /*
+     * Populate arena test case
+     */
+    tcase_add_test(arena_test_case, arena_results_stay_valid_until_reset);
+    tcase_add_test(arena_test_case, arena_failures_report_their_status);
+
+    /*
+     * Populate cache test case
+     */
+    tcase_add_test(cache_test_case, a_cache_shares_results_of_repeated_pairs);
+    tcase_add_test(cache_test_case, a_cache_remembers_failures);
+    tcase_add_test(cache_test_case,
+                   cached_results_outlive_eviction_and_the_cache);
+
+    /*
+     * Populate hook test case
+     */
+    tcase_add_test(hook_test_case,
+                   allocations_go_through_the_installed_allocator);
+    tcase_add_test(hook_test_case,
+                   counters_record_what_the_calling_thread_did);
+
+    /*
+     * Populate length-delimited input test case
+     */
+    tcase_add_test(length_delimited_test_case,
+                   numerals_are_read_from_slices_of_a_larger_buffer);
+    tcase_add_test(length_delimited_test_case,
+                   a_nul_byte_inside_a_slice_is_an_invalid_character);
+    tcase_add_test(length_delimited_test_case,
+                   length_delimited_functions_agree_with_string_functions);
+
     suite_add_tcase(test_suite, addition_test_case);
     suite_add_tcase(test_suite, subtraction_test_case);
+    suite_add_tcase(test_suite, buffer_test_case);
+    suite_add_tcase(test_suite, batch_test_case);
+    suite_add_tcase(test_suite, long_numeral_test_case);
+    suite_add_tcase(test_suite, context_test_case);
+    suite_add_tcase(test_suite, big_numeral_test_case);
+    suite_add_tcase(test_suite, accumulator_test_case);
+    suite_add_tcase(test_suite, conversion_test_case);
+    suite_add_tcase(test_suite, validation_test_case);
+    suite_add_tcase(test_suite, multiplication_test_case);
+    suite_add_tcase(test_suite, sorting_test_case);
+    suite_add_tcase(test_suite, column_test_case);
+    suite_add_tcase(test_suite, arena_test_case);
+    suite_add_tcase(test_suite, cache_test_case);
+    suite_add_tcase(test_suite, hook_test_case);
+    suite_add_tcase(test_suite, length_delimited_test_case);
 
     return test_suite;
 }
@@ -0,0 +1,126 @@
+/* check_roman_calculator_hpp.cpp */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "../src/roman_calculator.hpp"
+
+/*
+ * The constexpr layer is checked in two ways: static_asserts on literal
+ * arithmetic, which only compile if it is folded into constants, and a run
+ * over every pair of numerals up to a bound (plus some lenient and invalid
+ * ones) comparing it with the C library.
+ */
+
+using namespace roman::literals;
+
+#define AGREEMENT_BOUND 300
+
+/*
+ * Compile-time tests
+ */
+
+static_assert(("MCMXC"_roman + "XLII"_roman).to_text().view() == "MMXXXII");
+static_assert(("MM"_roman - "I"_roman).to_text().view() == "MCMXCIX");
+static_assert(("D"_roman + "CCCC"_roman).to_text().view() == "CM");
+static_assert(("IIIIIIIII"_roman).to_text().view() == "IX");
+static_assert(("XXXXXXXXXXXX"_roman - "IIIIIIIIIIIII"_roman).to_text().view()
+              == "CVII");
+static_assert(("MMMM"_roman + "MMMMM"_roman).length() == 9);
+static_assert(("X"_roman - "X"_roman).to_text().view().empty());
+static_assert(("IX"_roman == "VIIII"_roman));
+
+static_assert((roman::parse("I") - roman::parse("II")).status
+              == ROMAN_ERR_NEGATIVE_RESULT);
+static_assert(roman::parse("IVX").status == ROMAN_ERR_AMBIGUOUS_FORM);
+static_assert(roman::parse("XIQ").status == ROMAN_ERR_INVALID_CHARACTER);
+static_assert(roman::parse("").status == ROMAN_ERR_EMPTY_INPUT);
+static_assert(roman::parse(std::string_view("I\0I", 3)).status
+              == ROMAN_ERR_INVALID_CHARACTER);
+static_assert((roman::parse("Q") + roman::parse("I")).status
+              == ROMAN_ERR_INVALID_CHARACTER);
+
+/*
+ * Agreement with the C library
+ */
+
+static std::string encode(int value);
+static int  check_agreement(std::string_view numeral1,
+                            std::string_view numeral2);
+
+int main()
+{
+    const std::string_view unusual_numerals[] = {
+        "IIII", "VV", "XIIX", "IVI", "VX", "VL", "LD", "DM", "MCMXCIX",
+        "CCCCCCCCCCC", "IVX", "IIV", "XLIX", "MDCLXVI", "I Q", "", "IC",
+        std::string_view("I\0I", 3), std::string_view("X\0", 2)
+    };
+    const int number_of_unusual = sizeof(unusual_numerals)
+                                  / sizeof(unusual_numerals[0]);
+    unsigned long failures = 0;
+
+    for (int value1 = 1; value1 <= AGREEMENT_BOUND; value1++) {
+        for (int value2 = 1; value2 <= AGREEMENT_BOUND; value2++) {
+            failures += !check_agreement(encode(value1), encode(value2));
+        }
+    }
+    for (int first = 0; first < number_of_unusual; first++) {
+        for (int second = 0; second < number_of_unusual; second++) {
+            failures += !check_agreement(unusual_numerals[first],
+                                         unusual_numerals[second]);
+        }
+    }
+
+    std::printf("constexpr layer: %lu disagreements with the C library\n",
+                failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static std::string encode(int value)
+{
+    std::string numeral(value / 1000, 'M');
+    numeral += roman::detail::hundreds[value / 100 % 10];
+    numeral += roman::detail::tens[value / 10 % 10];
+    numeral += roman::detail::units[value % 10];
+    return numeral;
+}
+
+/**
+ * Both layers must give the same status and, on success, the same text. The
+ * numerals are passed to the C library with their lengths, since some of
+ * them have a '\0' inside.
+ */
+static int check_agreement(std::string_view numeral1,
+                           std::string_view numeral2)
+{
+    roman::numeral parsed1 = roman::parse(numeral1);
+    roman::numeral parsed2 = roman::parse(numeral2);
+    roman::numeral results[2] = {parsed1 + parsed2, parsed1 - parsed2};
+    const char *operators[2] = {"+", "-"};
+    char *c_result;
+    roman_status c_status;
+    int agrees = 1;
+
+    for (int operation = 0; operation < 2; operation++) {
+        c_status = (operation == 0)
+                   ? roman_add_n(numeral1.data(), numeral1.size(),
+                                 numeral2.data(), numeral2.size(), &c_result)
+                   : roman_subtract_n(numeral1.data(), numeral1.size(),
+                                      numeral2.data(), numeral2.size(),
+                                      &c_result);
+
+        if (c_status != results[operation].status
+            || (c_status == ROMAN_OK
+                && results[operation].to_text().view() != c_result)) {
+            std::fprintf(stderr, "\"%.*s\" %s \"%.*s\" disagrees\n",
+                         (int)numeral1.size(), numeral1.data(),
+                         operators[operation], (int)numeral2.size(),
+                         numeral2.data());
+            agrees = 0;
+        }
+        std::free(c_result);
+    }
+    return agrees;
+}
@@ -0,0 +1,183 @@
+/* exhaustive_roman_calculator.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/roman_calculator.h"
+
+/*
+ * Checks the sum and the difference of every pair of numerals from I up to a
+ * bound (3999 by default) against an independent reference encoder, with the
+ * pairs split between threads. Above 3999 the reference keeps prepending 'M'
+ * characters, so larger bounds exercise carries into long runs of 'M'.
+ *
+ * Usage: exhaustive_roman_calculator.o [bound [number of threads]]
+ */
+
+#define DEFAULT_BOUND 3999
+
+typedef struct {
+    int first;
+    int stride;
+    unsigned long checks;
+    unsigned long failures;
+    char first_failure[128];
+} worker;
+
+static char **reference_numerals;
+static size_t longest_numeral;
+static int bound;
+
+static char *encode_reference_numeral(int value);
+static void *run_worker(void *argument);
+static void  check_pair(worker *state, char *result, int value1, int value2);
+static void  record_failure(worker *state, const char *operation, int value1,
+                            int value2, const char *result);
+
+int main(int argc, char **argv)
+{
+    int number_of_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_t *threads;
+    worker *workers;
+    unsigned long checks = 0;
+    unsigned long failures = 0;
+    struct timespec start;
+    struct timespec end;
+
+    int value;
+    int current;
+
+    bound = (argc > 1) ? atoi(argv[1]) : DEFAULT_BOUND;
+    if (argc > 2) number_of_threads = atoi(argv[2]);
+    if (bound < 1 || number_of_threads < 1) {
+        fprintf(stderr, "usage: %s [bound [number of threads]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Sums go up to twice the bound; zero is the empty numeral. */
+    reference_numerals = malloc((2 * (size_t)bound + 1) * sizeof(char *));
+    for (value = 0; value <= 2 * bound; value++) {
+        reference_numerals[value] = encode_reference_numeral(value);
+    }
+    longest_numeral = strlen(reference_numerals[2 * bound]) + 16;
+
+    threads = malloc(number_of_threads * sizeof(pthread_t));
+    workers = malloc(number_of_threads * sizeof(worker));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (current = 0; current < number_of_threads; current++) {
+        workers[current].first = current + 1;
+        workers[current].stride = number_of_threads;
+        workers[current].checks = 0;
+        workers[current].failures = 0;
+        pthread_create(&threads[current], NULL, run_worker,
+                       &workers[current]);
+    }
+
+    for (current = 0; current < number_of_threads; current++) {
+        pthread_join(threads[current], NULL);
+        checks += workers[current].checks;
+        failures += workers[current].failures;
+        if (workers[current].failures > 0) {
+            fprintf(stderr, "%s\n", workers[current].first_failure);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%lu checks up to %d on %d threads in %.2f s: %lu failures\n",
+           checks, bound, number_of_threads,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+           failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * The canonical numeral for a value, built greedily from the largest
+ * character or subtractive pair that fits, without using the calculator.
+ */
+static char *encode_reference_numeral(int value)
+{
+    static const int values[13] = {
+        1000, 900, 500, 400, 100, 90, 50, 40, 10, 9, 5, 4, 1
+    };
+    static const char *const symbols[13] = {
+        "M", "CM", "D", "CD", "C", "XC", "L", "XL", "X", "IX", "V", "IV", "I"
+    };
+    char *numeral = malloc(value / 1000 + 16);
+    size_t length = 0;
+
+    int symbol;
+    for (symbol = 0; symbol < 13; symbol++) {
+        while (value >= values[symbol]) {
+            strcpy(numeral + length, symbols[symbol]);
+            length += strlen(symbols[symbol]);
+            value -= values[symbol];
+        }
+    }
+    numeral[length] = '\0';
+    return numeral;
+}
+
+/** Checks every pair whose first value is in the worker's share. */
+static void *run_worker(void *argument)
+{
+    worker *state = argument;
+    char *result = malloc(longest_numeral);
+
+    int value1;
+    int value2;
+
+    for (value1 = state->first; value1 <= bound; value1 += state->stride) {
+        for (value2 = 1; value2 <= bound; value2++) {
+            check_pair(state, result, value1, value2);
+        }
+    }
+
+    free(result);
+    return NULL;
+}
+
+/**
+ * The sum must match the reference, as must the difference when it is not
+ * negative (zero being the empty numeral); a negative one must be refused.
+ */
+static void check_pair(worker *state, char *result, int value1, int value2)
+{
+    const char *numeral1 = reference_numerals[value1];
+    const char *numeral2 = reference_numerals[value2];
+    roman_status status;
+
+    add_roman_numerals_into(numeral1, numeral2, result, longest_numeral,
+                            &status);
+    if (status != ROMAN_OK
+        || strcmp(result, reference_numerals[value1 + value2]) != 0) {
+        record_failure(state, "+", value1, value2, result);
+    }
+
+    subtract_roman_numerals_into(numeral1, numeral2, result, longest_numeral,
+                                 &status);
+    if (value1 < value2) {
+        if (status != ROMAN_ERR_NEGATIVE_RESULT) {
+            record_failure(state, "-", value1, value2, result);
+        }
+    } else if (status != ROMAN_OK
+               || strcmp(result, reference_numerals[value1 - value2]) != 0) {
+        record_failure(state, "-", value1, value2, result);
+    }
+
+    state->checks += 2;
+}
+
+static void record_failure(worker *state, const char *operation, int value1,
+                           int value2, const char *result)
+{
+    if (state->failures++ > 0) return;
+
+    sprintf(state->first_failure, "%d %s %d gave \"%.64s\"", value1,
+            operation, value2, result);
+}
@@ -0,0 +1,40 @@
+/* generate_canonical_numerals.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Prints the initializers of the table of canonical Roman numerals for the
+ * values 0 through 999 used by roman_calculator.c to render results. Each
+ * entry is written as {length, "numeral"}.
+ */
+
+#define NUMBER_OF_TAIL_VALUES 1000
+
+static const char *const hundreds[10] = {
+    "", "C", "CC", "CCC", "CD", "D", "DC", "DCC", "DCCC", "CM"
+};
+static const char *const tens[10] = {
+    "", "X", "XX", "XXX", "XL", "L", "LX", "LXX", "LXXX", "XC"
+};
+static const char *const units[10] = {
+    "", "I", "II", "III", "IV", "V", "VI", "VII", "VIII", "IX"
+};
+
+int main(void)
+{
+    char numeral[16];
+
+    int value;
+
+    printf("/* Generated by tools/generate_canonical_numerals.c */\n");
+    for (value = 0; value < NUMBER_OF_TAIL_VALUES; value++) {
+        strcpy(numeral, hundreds[value / 100]);
+        strcat(numeral, tens[value / 10 % 10]);
+        strcat(numeral, units[value % 10]);
+
+        printf("{%2lu, \"%s\"},\n", (unsigned long)strlen(numeral), numeral);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+/* roman_calc.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "roman_calculator.h"
+
+/*
+ * Reads one expression per line, such as "MCMXC + XLII" or "MM - I", and
+ * writes one result per line: the numeral, or "error: " followed by what went
+ * wrong. Input comes from the named file (mapped into memory) or from stdin
+ * (read in large blocks), and is evaluated by roman_evaluate_lines on as many
+ * threads as there are processors unless --threads says otherwise.
+ *
+ * Usage: roman_calc [--stats] [--threads N] [file]
+ */
+
+#define INPUT_BLOCK_SIZE (16 * 1024 * 1024)
+
+typedef struct {
+    int number_of_threads;
+    roman_line_totals totals;
+    unsigned long long bytes;
+} calculator;
+
+static int  evaluate_file(calculator *calc, const char *path);
+static int  evaluate_stream(calculator *calc, FILE *input);
+static int  evaluate_block(calculator *calc, const char *block,
+                           size_t length);
+static int  write_to_stdout(void *context, const char *bytes, size_t length);
+static void print_statistics(const calculator *calc,
+                             const struct timespec *start);
+static void print_usage(const char *program);
+
+int main(int argc, char **argv)
+{
+    calculator calc;
+    struct timespec start;
+    const char *path = NULL;
+    int show_statistics = 0;
+    int succeeded;
+
+    int argument;
+
+    memset(&calc, 0, sizeof(calc));
+    calc.number_of_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (argument = 1; argument < argc; argument++) {
+        if (strcmp(argv[argument], "--stats") == 0) {
+            show_statistics = 1;
+        } else if (strcmp(argv[argument], "--threads") == 0
+                   && argument + 1 < argc) {
+            calc.number_of_threads = atoi(argv[++argument]);
+            if (calc.number_of_threads < 1) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (!path && argv[argument][0] != '-') {
+            path = argv[argument];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (calc.number_of_threads < 1) calc.number_of_threads = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    succeeded = (path) ? evaluate_file(&calc, path)
+                       : evaluate_stream(&calc, stdin);
+    if (fflush(stdout) != 0) {
+        perror("roman_calc");
+        succeeded = 0;
+    }
+
+    if (show_statistics) print_statistics(&calc, &start);
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Reading input
+ */
+
+/**
+ * Map the whole file into memory, which works for files of any size on 64-bit
+ * systems, and evaluate it in place.
+ */
+static int evaluate_file(calculator *calc, const char *path)
+{
+    struct stat file_status;
+    const char *contents;
+    int succeeded;
+    int file = open(path, O_RDONLY);
+
+    if (file < 0 || fstat(file, &file_status) != 0) {
+        perror(path);
+        if (file >= 0) close(file);
+        return 0;
+    }
+    if (file_status.st_size == 0) {
+        close(file);
+        return 1;
+    }
+
+    contents = mmap(NULL, file_status.st_size, PROT_READ, MAP_PRIVATE, file,
+                    0);
+    close(file);
+    if (contents == MAP_FAILED) {
+        perror(path);
+        return 0;
+    }
+    posix_madvise((void *)contents, file_status.st_size,
+                  POSIX_MADV_SEQUENTIAL);
+
+    succeeded = evaluate_block(calc, contents, file_status.st_size);
+
+    munmap((void *)contents, file_status.st_size);
+    return succeeded;
+}
+
+/**
+ * Read the stream in large blocks, evaluating the complete lines of each and
+ * carrying a partial last line over to the front of the buffer.
+ */
+static int evaluate_stream(calculator *calc, FILE *input)
+{
+    char *buffer = malloc(INPUT_BLOCK_SIZE);
+    size_t buffer_size = INPUT_BLOCK_SIZE;
+    size_t used = 0;
+    size_t complete;
+    size_t bytes_read;
+    char *larger_buffer;
+    int succeeded = 1;
+
+    if (!buffer) {
+        fprintf(stderr, "roman_calc: out of memory\n");
+        return 0;
+    }
+
+    while (succeeded
+           && (bytes_read = fread(buffer + used, 1, buffer_size - used,
+                                  input)) > 0) {
+        used += bytes_read;
+
+        complete = used;
+        while (complete > 0 && buffer[complete - 1] != '\n') complete--;
+
+        if (complete > 0) {
+            succeeded = evaluate_block(calc, buffer, complete);
+            used -= complete;
+            memmove(buffer, buffer + complete, used);
+        } else if (used == buffer_size) {
+            /* A line longer than the buffer makes the buffer grow. */
+            larger_buffer = realloc(buffer, buffer_size * 2);
+            if (larger_buffer) {
+                buffer = larger_buffer;
+                buffer_size *= 2;
+            } else {
+                fprintf(stderr, "roman_calc: out of memory\n");
+                succeeded = 0;
+            }
+        }
+    }
+
+    if (ferror(input)) {
+        perror("roman_calc");
+        succeeded = 0;
+    } else if (succeeded && used > 0) {
+        succeeded = evaluate_block(calc, buffer, used);
+    }
+
+    free(buffer);
+    return succeeded;
+}
+
+static int evaluate_block(calculator *calc, const char *block,
+                          size_t length)
+{
+    roman_line_totals totals;
+    roman_status status;
+
+    status = roman_evaluate_lines(block, length, calc->number_of_threads,
+                                  write_to_stdout, NULL, &totals);
+
+    calc->totals.lines += totals.lines;
+    calc->totals.errors += totals.errors;
+    calc->bytes += length;
+
+    if (status != ROMAN_OK) {
+        fprintf(stderr, "roman_calc: %s\n", roman_status_message(status));
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Writing output
+ */
+
+static int write_to_stdout(void *context, const char *bytes, size_t length)
+{
+    (void)context;
+    return fwrite(bytes, 1, length, stdout) == length ? 0 : -1;
+}
+
+static void print_statistics(const calculator *calc,
+                             const struct timespec *start)
+{
+    struct timespec now;
+    double elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - start->tv_sec)
+              + (now.tv_nsec - start->tv_nsec) / 1e9;
+    if (elapsed <= 0) elapsed = 1e-9;
+
+    fprintf(stderr,
+            "%llu lines (%llu errors), %llu bytes on %d threads in %.3f s: "
+            "%.1f MB/s, %.0f lines/s\n",
+            (unsigned long long)calc->totals.lines,
+            (unsigned long long)calc->totals.errors, calc->bytes,
+            calc->number_of_threads, elapsed, calc->bytes / elapsed / 1e6,
+            calc->totals.lines / elapsed);
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--stats] [--threads N] [file]\n", program);
+}
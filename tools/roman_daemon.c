@@ -0,0 +1,663 @@
+/* roman_daemon.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "roman_calculator.h"
+#include "roman_protocol.h"
+
+/*
+ * Serves additions and subtractions to other processes on the same machine
+ * over a Unix domain socket, speaking the batch protocol of roman_protocol.h.
+ * The main thread accepts connections and hands each to one of the worker
+ * threads in turn. Every worker runs an epoll loop of its own over the
+ * connections it was given, reads the numerals of a batch where they lie in
+ * the connection's input buffer, and answers the batch with one writev of a
+ * result table and result text that the worker reuses for every batch. A
+ * client that does not read its responses is not read from either until they
+ * have gone out. SIGINT or SIGTERM stops the daemon and removes the socket.
+ *
+ * Usage: roman_daemon [--stats] [--threads N] socket
+ */
+
+#define MAXIMUM_EVENTS 64
+#define READ_SIZE (64 * 1024)
+#define INITIAL_TEXT_CAPACITY (64 * 1024)
+
+typedef struct connection {
+    struct connection *next;
+    struct connection *previous;
+    int fd;
+    int writing;                /* watched for EPOLLOUT instead of EPOLLIN */
+    unsigned char *input;
+    size_t input_length;
+    size_t input_capacity;
+    unsigned char *pending;     /* what writev could not send right away */
+    size_t pending_length;
+    size_t pending_sent;
+    size_t pending_capacity;
+} connection;
+
+typedef struct {
+    pthread_t thread;
+    int epoll_fd;
+    pthread_mutex_t lock;       /* guards connections, which main adds to */
+    connection *connections;
+    unsigned char *table;       /* response header and result table */
+    size_t table_capacity;
+    unsigned char *text;        /* result text */
+    size_t text_capacity;
+    unsigned long long batches;
+    unsigned long long requests;
+} worker;
+
+static int   signal_pipe[2] = {-1, -1};
+
+static int   listen_on(const char *path);
+static int   start_workers(worker *workers, int number_of_workers,
+                           int stop_fd);
+static int   serve(int listener, worker *workers, int number_of_workers);
+static void  hand_over(worker *owner, int fd);
+static void  stop_workers(worker *workers, int number_of_workers,
+                          int stop_fd);
+static void  note_signal(int signal_number);
+static int   watch(int epoll_fd, int fd, void *data, uint32_t events);
+static void  print_usage(const char *program);
+
+/* Workers */
+static void *run_worker(void *argument);
+static int   serve_connection(worker *self, connection *client,
+                              uint32_t events);
+static int   read_input(connection *client);
+static int   answer_batches(worker *self, connection *client);
+static int   answer_batch(worker *self, connection *client,
+                          const unsigned char *body, size_t body_length);
+static size_t calculate_into_text(worker *self, size_t text_used,
+                                  char operation, const char *numeral1,
+                                  size_t length1, const char *numeral2,
+                                  size_t length2, roman_status *status);
+static int   send_response(connection *client, const struct iovec *pieces,
+                           int number_of_pieces);
+static int   flush_pending(connection *client);
+static int   update_interest(worker *self, connection *client);
+static void  close_connection(worker *self, connection *client);
+static int   reserve_buffer(unsigned char **buffer, size_t *capacity,
+                            size_t needed);
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int number_of_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int show_statistics = 0;
+    worker *workers;
+    int stop_pipe[2];
+    int listener;
+    int succeeded;
+    unsigned long long batches = 0;
+    unsigned long long requests = 0;
+
+    int argument;
+    int current;
+
+    for (argument = 1; argument < argc; argument++) {
+        if (strcmp(argv[argument], "--stats") == 0) {
+            show_statistics = 1;
+        } else if (strcmp(argv[argument], "--threads") == 0
+                   && argument + 1 < argc) {
+            number_of_workers = atoi(argv[++argument]);
+            if (number_of_workers < 1) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (!path && argv[argument][0] != '-') {
+            path = argv[argument];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!path) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (number_of_workers < 1) number_of_workers = 1;
+
+    workers = calloc(number_of_workers, sizeof(worker));
+    /* The handler must never block, so the pipe it writes to does not. */
+    if (!workers || pipe(stop_pipe) != 0 || pipe(signal_pipe) != 0
+        || fcntl(signal_pipe[0], F_SETFD, FD_CLOEXEC) != 0
+        || fcntl(signal_pipe[1], F_SETFD, FD_CLOEXEC) != 0
+        || fcntl(signal_pipe[1], F_SETFL, O_NONBLOCK) != 0) {
+        perror("roman_daemon");
+        return EXIT_FAILURE;
+    }
+    listener = listen_on(path);
+    if (listener < 0) return EXIT_FAILURE;
+
+    if (!start_workers(workers, number_of_workers, stop_pipe[0])) {
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+    succeeded = serve(listener, workers, number_of_workers);
+    stop_workers(workers, number_of_workers, stop_pipe[1]);
+
+    close(listener);
+    unlink(path);
+    for (current = 0; current < number_of_workers; current++) {
+        batches += workers[current].batches;
+        requests += workers[current].requests;
+    }
+    if (show_statistics) {
+        fprintf(stderr, "roman_daemon: %llu batches, %llu requests\n",
+                batches, requests);
+    }
+    free(workers);
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Accepting connections
+ */
+
+static int listen_on(const char *path)
+{
+    struct sockaddr_un address;
+    int listener;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "roman_daemon: socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    /* A socket left behind by a daemon that did not stop cleanly */
+    unlink(path);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0
+        || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0
+        || listen(listener, SOMAXCONN) != 0
+        || fcntl(listener, F_SETFL, O_NONBLOCK) != 0) {
+        perror(path);
+        if (listener >= 0) close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+/**
+ * Start the workers with SIGINT and SIGTERM blocked, so that only the main
+ * thread sees them. Each worker's epoll set holds the read end of the stop
+ * pipe, which becomes readable for all of them at once when it is time to
+ * stop. Returns 0 on failure.
+ */
+static int start_workers(worker *workers, int number_of_workers,
+                         int stop_fd)
+{
+    struct sigaction action;
+    sigset_t stopping;
+    sigset_t previous;
+
+    int current;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = note_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    sigemptyset(&stopping);
+    sigaddset(&stopping, SIGINT);
+    sigaddset(&stopping, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopping, &previous);
+
+    for (current = 0; current < number_of_workers; current++) {
+        workers[current].epoll_fd = epoll_create(MAXIMUM_EVENTS);
+        workers[current].text = malloc(INITIAL_TEXT_CAPACITY);
+        workers[current].text_capacity = INITIAL_TEXT_CAPACITY;
+        pthread_mutex_init(&workers[current].lock, NULL);
+        if (workers[current].epoll_fd < 0 || !workers[current].text
+            || !watch(workers[current].epoll_fd, stop_fd, NULL, EPOLLIN)
+            || pthread_create(&workers[current].thread, NULL, run_worker,
+                              &workers[current]) != 0) {
+            perror("roman_daemon");
+            return 0;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    return 1;
+}
+
+/** Accept connections until a signal arrives; returns 0 on failure. */
+static int serve(int listener, worker *workers, int number_of_workers)
+{
+    struct epoll_event events[2];
+    int epoll_fd = epoll_create(2);
+    int next_worker = 0;
+    int count;
+    int fd;
+
+    int index;
+
+    if (epoll_fd < 0 || !watch(epoll_fd, listener, &listener, EPOLLIN)
+        || !watch(epoll_fd, signal_pipe[0], NULL, EPOLLIN)) {
+        perror("roman_daemon");
+        return 0;
+    }
+
+    for (;;) {
+        count = epoll_wait(epoll_fd, events, 2, -1);
+        if (count < 0 && errno != EINTR) {
+            perror("roman_daemon");
+            close(epoll_fd);
+            return 0;
+        }
+        for (index = 0; index < count; index++) {
+            if (!events[index].data.ptr) {
+                close(epoll_fd);
+                return 1;
+            }
+            while ((fd = accept(listener, NULL, NULL)) >= 0) {
+                hand_over(&workers[next_worker], fd);
+                next_worker = (next_worker + 1) % number_of_workers;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("roman_daemon: accept");
+            }
+        }
+    }
+}
+
+static void hand_over(worker *owner, int fd)
+{
+    connection *client = calloc(1, sizeof(connection));
+
+    if (!client || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+        fprintf(stderr, "roman_daemon: dropping a connection\n");
+        free(client);
+        close(fd);
+        return;
+    }
+    client->fd = fd;
+
+    pthread_mutex_lock(&owner->lock);
+    client->next = owner->connections;
+    if (owner->connections) owner->connections->previous = client;
+    owner->connections = client;
+    pthread_mutex_unlock(&owner->lock);
+
+    /* From here on, only the owner touches the connection. */
+    if (!watch(owner->epoll_fd, fd, client, EPOLLIN)) {
+        perror("roman_daemon");
+        close_connection(owner, client);
+    }
+}
+
+static void stop_workers(worker *workers, int number_of_workers,
+                         int stop_fd)
+{
+    int current;
+
+    if (write(stop_fd, "", 1) != 1) perror("roman_daemon");
+    for (current = 0; current < number_of_workers; current++) {
+        pthread_join(workers[current].thread, NULL);
+        while (workers[current].connections) {
+            close_connection(&workers[current],
+                             workers[current].connections);
+        }
+        close(workers[current].epoll_fd);
+        pthread_mutex_destroy(&workers[current].lock);
+        free(workers[current].table);
+        free(workers[current].text);
+    }
+}
+
+static void note_signal(int signal_number)
+{
+    int saved_errno = errno;
+
+    (void)signal_number;
+    if (write(signal_pipe[1], "", 1) < 0) {
+        /* The pipe is full, so the main thread is waking up anyway. */
+    }
+    errno = saved_errno;
+}
+
+static int watch(int epoll_fd, int fd, void *data, uint32_t events)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = data;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--stats] [--threads N] socket\n", program);
+}
+
+/*
+ * Workers
+ */
+
+static void *run_worker(void *argument)
+{
+    worker *self = argument;
+    struct epoll_event events[MAXIMUM_EVENTS];
+    connection *client;
+    int count;
+
+    int index;
+
+    for (;;) {
+        count = epoll_wait(self->epoll_fd, events, MAXIMUM_EVENTS, -1);
+        if (count < 0 && errno != EINTR) {
+            perror("roman_daemon");
+            return NULL;
+        }
+        for (index = 0; index < count; index++) {
+            client = events[index].data.ptr;
+            if (!client) return NULL;
+            if (!serve_connection(self, client, events[index].events)) {
+                close_connection(self, client);
+            }
+        }
+    }
+}
+
+/**
+ * Send what is pending, read what has arrived and answer every complete
+ * batch. Returns 0 once the connection should be closed.
+ */
+static int serve_connection(worker *self, connection *client,
+                            uint32_t events)
+{
+    if ((events & EPOLLOUT) && !flush_pending(client)) return 0;
+    if (client->pending_length == 0
+        && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        && !read_input(client)) {
+        return 0;
+    }
+    return answer_batches(self, client) && update_interest(self, client);
+}
+
+/** One read per event; returns 0 at the end of input or on an error. */
+static int read_input(connection *client)
+{
+    ssize_t bytes_read;
+
+    if (!reserve_buffer(&client->input, &client->input_capacity,
+                        client->input_length + READ_SIZE)) {
+        return 0;
+    }
+    bytes_read = read(client->fd, client->input + client->input_length,
+                      client->input_capacity - client->input_length);
+    if (bytes_read < 0) return errno == EAGAIN || errno == EWOULDBLOCK
+                               || errno == EINTR;
+    if (bytes_read == 0) return 0;
+
+    client->input_length += bytes_read;
+    return 1;
+}
+
+/**
+ * Answer the complete batches at the front of the input, stopping early if a
+ * response could not be sent in full, and move what is left to the front.
+ */
+static int answer_batches(worker *self, connection *client)
+{
+    size_t consumed = 0;
+    size_t body_length;
+
+    while (client->pending_length == 0
+           && client->input_length - consumed >= PROTOCOL_LENGTH_SIZE) {
+        body_length = protocol_get_u32(client->input + consumed);
+        if (body_length > PROTOCOL_MAXIMUM_BODY) return 0;
+        if (client->input_length - consumed - PROTOCOL_LENGTH_SIZE
+            < body_length) {
+            break;
+        }
+
+        if (!answer_batch(self, client,
+                          client->input + consumed + PROTOCOL_LENGTH_SIZE,
+                          body_length)) {
+            return 0;
+        }
+        consumed += PROTOCOL_LENGTH_SIZE + body_length;
+    }
+
+    client->input_length -= consumed;
+    memmove(client->input, client->input + consumed, client->input_length);
+    return 1;
+}
+
+/**
+ * Calculate every request of a batch into the worker's result table and text
+ * and send them as one response. Returns 0 if the batch does not parse or
+ * the response cannot be sent.
+ */
+static int answer_batch(worker *self, connection *client,
+                        const unsigned char *body, size_t body_length)
+{
+    size_t count;
+    size_t offset = PROTOCOL_LENGTH_SIZE;
+    size_t table_length;
+    size_t text_length = 0;
+    size_t result_length;
+    char operation;
+    const char *numeral1;
+    const char *numeral2;
+    size_t length1;
+    size_t length2;
+    roman_status status;
+    unsigned char *entry;
+    struct iovec pieces[2];
+
+    size_t index;
+
+    if (body_length < PROTOCOL_LENGTH_SIZE) return 0;
+    count = protocol_get_u32(body);
+
+    /* Every request takes at least its header, which bounds the table. */
+    if (count > (body_length - PROTOCOL_LENGTH_SIZE)
+                / PROTOCOL_REQUEST_HEADER_SIZE) {
+        return 0;
+    }
+    table_length = 2 * PROTOCOL_LENGTH_SIZE
+                   + count * PROTOCOL_RESULT_HEADER_SIZE;
+    if (!reserve_buffer(&self->table, &self->table_capacity,
+                        table_length)) {
+        return 0;
+    }
+
+    for (index = 0; index < count; index++) {
+        offset = protocol_read_request(body, body_length, offset, &operation,
+                                       &numeral1, &length1, &numeral2,
+                                       &length2);
+        if (offset == 0) return 0;
+
+        result_length = calculate_into_text(self, text_length, operation,
+                                            numeral1, length1, numeral2,
+                                            length2, &status);
+        entry = self->table + 2 * PROTOCOL_LENGTH_SIZE
+                + index * PROTOCOL_RESULT_HEADER_SIZE;
+        entry[0] = (unsigned char)status;
+        protocol_put_u32(entry + 1, (uint32_t)result_length);
+        text_length += result_length;
+    }
+    if (offset != body_length
+        || table_length - PROTOCOL_LENGTH_SIZE + text_length > UINT32_MAX) {
+        return 0;
+    }
+
+    protocol_put_u32(self->table,
+                     (uint32_t)(table_length - PROTOCOL_LENGTH_SIZE
+                                + text_length));
+    protocol_put_u32(self->table + PROTOCOL_LENGTH_SIZE, (uint32_t)count);
+    pieces[0].iov_base = self->table;
+    pieces[0].iov_len = table_length;
+    pieces[1].iov_base = self->text;
+    pieces[1].iov_len = text_length;
+
+    self->batches++;
+    self->requests += count;
+    return send_response(client, pieces, 2);
+}
+
+/**
+ * Write one result into the text buffer at text_used, growing the buffer
+ * until it fits. Returns its length, which is 0 for a failed request.
+ */
+static size_t calculate_into_text(worker *self, size_t text_used,
+                                  char operation, const char *numeral1,
+                                  size_t length1, const char *numeral2,
+                                  size_t length2, roman_status *status)
+{
+    size_t length;
+
+    if (operation != '+' && operation != '-') {
+        *status = ROMAN_ERR_SYNTAX;
+        return 0;
+    }
+
+    for (;;) {
+        length = (operation == '+')
+                 ? add_roman_numerals_into_n(numeral1, length1, numeral2,
+                                             length2,
+                                             (char *)self->text + text_used,
+                                             self->text_capacity - text_used,
+                                             status)
+                 : subtract_roman_numerals_into_n(
+                       numeral1, length1, numeral2, length2,
+                       (char *)self->text + text_used,
+                       self->text_capacity - text_used, status);
+        if (*status != ROMAN_OK) return 0;
+        if (length < self->text_capacity - text_used) return length;
+
+        if (!reserve_buffer(&self->text, &self->text_capacity,
+                            text_used + length + 1)) {
+            *status = ROMAN_ERR_OUT_OF_MEMORY;
+            return 0;
+        }
+    }
+}
+
+/** writev the pieces, keeping whatever the socket did not take for later. */
+static int send_response(connection *client, const struct iovec *pieces,
+                         int number_of_pieces)
+{
+    ssize_t written = writev(client->fd, pieces, number_of_pieces);
+    size_t skip;
+
+    int piece;
+
+    if (written < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return 0;
+        }
+        written = 0;
+    }
+
+    skip = (size_t)written;
+    for (piece = 0; piece < number_of_pieces; piece++) {
+        if (skip >= pieces[piece].iov_len) {
+            skip -= pieces[piece].iov_len;
+            continue;
+        }
+        if (!reserve_buffer(&client->pending, &client->pending_capacity,
+                            client->pending_length + pieces[piece].iov_len
+                            - skip)) {
+            return 0;
+        }
+        memcpy(client->pending + client->pending_length,
+               (const unsigned char *)pieces[piece].iov_base + skip,
+               pieces[piece].iov_len - skip);
+        client->pending_length += pieces[piece].iov_len - skip;
+        skip = 0;
+    }
+    return 1;
+}
+
+static int flush_pending(connection *client)
+{
+    ssize_t written;
+
+    while (client->pending_sent < client->pending_length) {
+        written = write(client->fd, client->pending + client->pending_sent,
+                        client->pending_length - client->pending_sent);
+        if (written < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client->pending_sent += written;
+    }
+    client->pending_length = 0;
+    client->pending_sent = 0;
+    return 1;
+}
+
+/** Wait to write while a response is pending, and to read otherwise. */
+static int update_interest(worker *self, connection *client)
+{
+    struct epoll_event event;
+    int writing = (client->pending_length > 0);
+
+    if (writing == client->writing) return 1;
+
+    memset(&event, 0, sizeof(event));
+    event.events = writing ? EPOLLOUT : EPOLLIN;
+    event.data.ptr = client;
+    client->writing = writing;
+    return epoll_ctl(self->epoll_fd, EPOLL_CTL_MOD, client->fd, &event) == 0;
+}
+
+static void close_connection(worker *self, connection *client)
+{
+    pthread_mutex_lock(&self->lock);
+    if (client->previous) {
+        client->previous->next = client->next;
+    } else {
+        self->connections = client->next;
+    }
+    if (client->next) client->next->previous = client->previous;
+    pthread_mutex_unlock(&self->lock);
+
+    close(client->fd);
+    free(client->input);
+    free(client->pending);
+    free(client);
+}
+
+/** Grow a buffer to hold at least needed bytes, at least doubling it. */
+static int reserve_buffer(unsigned char **buffer, size_t *capacity,
+                          size_t needed)
+{
+    size_t new_capacity;
+    unsigned char *new_buffer;
+
+    if (needed <= *capacity) return 1;
+
+    new_capacity = (*capacity * 2 > needed) ? *capacity * 2 : needed;
+    new_buffer = realloc(*buffer, new_capacity);
+    if (!new_buffer) return 0;
+
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return 1;
+}
@@ -0,0 +1,468 @@
+/* roman_loadgen.c */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "roman_calculator.h"
+#include "roman_protocol.h"
+
+/*
+ * Puts load on roman_daemon: each of several connections, on a thread of its
+ * own, keeps up to depth batches of requests in flight and checks every
+ * result it gets back against the values it asked about. Batches mix
+ * additions, subtractions (some of them negative) and invalid numerals.
+ * Reports throughput and the 50th and 99th percentile time from sending a
+ * batch to receiving its response, and fails if any result was wrong.
+ *
+ * Usage: roman_loadgen [--connections N] [--batches N] [--batch-size N]
+ *                      [--depth N] socket
+ */
+
+#define MAXIMUM_VALUE 3999
+#define DISTINCT_BATCHES 8
+#define INVALID_EVERY 16
+#define INVALID_NUMERAL "MQ"
+#define CONNECT_ATTEMPTS 100
+#define READ_SIZE (64 * 1024)
+
+typedef struct {
+    roman_status status;
+    uint64_t value;
+} expected_result;
+
+typedef struct {
+    unsigned char *bytes;
+    size_t length;
+    expected_result *expected;
+} prepared_batch;
+
+typedef struct {
+    pthread_t thread;
+    const char *path;
+    unsigned seed;
+    size_t batches;
+    size_t batch_size;
+    size_t depth;
+    prepared_batch prepared[DISTINCT_BATCHES];
+    double *latencies;          /* seconds, one per batch */
+    struct timespec *sent_at;   /* ring of depth send times */
+    unsigned long long wrong;
+    int failed;
+} load_client;
+
+static int    parse_size(const char *text, size_t *value);
+static void  *run_client(void *argument);
+static int    connect_to(const char *path);
+static int    prepare_batch(load_client *client, prepared_batch *batch);
+static int    exchange_batches(load_client *client, int fd);
+static size_t check_responses(load_client *client, const unsigned char *input,
+                              size_t length, size_t *received);
+static unsigned long long check_response(const load_client *client,
+                                         const unsigned char *body,
+                                         size_t body_length,
+                                         const expected_result *expected);
+static int    compare_latencies(const void *latency1, const void *latency2);
+static double seconds_between(const struct timespec *start,
+                              const struct timespec *end);
+static void   print_usage(const char *program);
+
+int main(int argc, char **argv)
+{
+    size_t connections = 4;
+    size_t batches = 2000;
+    size_t batch_size = 64;
+    size_t depth = 8;
+    const char *path = NULL;
+    load_client *clients;
+    double *latencies;
+    struct timespec start;
+    struct timespec end;
+    double seconds;
+    unsigned long long wrong = 0;
+    int failed = 0;
+    size_t total_batches;
+
+    int argument;
+    size_t current;
+
+    for (argument = 1; argument < argc; argument++) {
+        if (argument + 1 < argc
+            && ((strcmp(argv[argument], "--connections") == 0
+                 && parse_size(argv[argument + 1], &connections))
+                || (strcmp(argv[argument], "--batches") == 0
+                    && parse_size(argv[argument + 1], &batches))
+                || (strcmp(argv[argument], "--batch-size") == 0
+                    && parse_size(argv[argument + 1], &batch_size))
+                || (strcmp(argv[argument], "--depth") == 0
+                    && parse_size(argv[argument + 1], &depth)))) {
+            argument++;
+        } else if (!path && argv[argument][0] != '-') {
+            path = argv[argument];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!path) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    total_batches = connections * batches;
+    clients = calloc(connections, sizeof(load_client));
+    latencies = malloc(total_batches * sizeof(double));
+    if (!clients || !latencies) {
+        fprintf(stderr, "roman_loadgen: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (current = 0; current < connections; current++) {
+        clients[current].path = path;
+        clients[current].seed = 12345 + (unsigned)current;
+        clients[current].batches = batches;
+        clients[current].batch_size = batch_size;
+        clients[current].depth = depth;
+        clients[current].latencies = latencies + current * batches;
+        if (pthread_create(&clients[current].thread, NULL, run_client,
+                           &clients[current]) != 0) {
+            perror("roman_loadgen");
+            return EXIT_FAILURE;
+        }
+    }
+    for (current = 0; current < connections; current++) {
+        pthread_join(clients[current].thread, NULL);
+        wrong += clients[current].wrong;
+        failed |= clients[current].failed;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = seconds_between(&start, &end);
+
+    if (failed) {
+        fprintf(stderr, "roman_loadgen: a connection failed\n");
+        return EXIT_FAILURE;
+    }
+
+    qsort(latencies, total_batches, sizeof(double), compare_latencies);
+    printf("%lu connections, %lu requests per batch, up to %lu batches in "
+           "flight each\n", (unsigned long)connections,
+           (unsigned long)batch_size, (unsigned long)depth);
+    printf("%lu requests in %.3f s: %.0f requests/s\n",
+           (unsigned long)(total_batches * batch_size), seconds,
+           total_batches * batch_size / seconds);
+    printf("batch latency: p50 %.1f us, p99 %.1f us\n",
+           latencies[total_batches / 2] * 1e6,
+           latencies[total_batches - 1 - total_batches / 100] * 1e6);
+    printf("%llu wrong results\n", wrong);
+
+    free(clients);
+    free(latencies);
+    return (wrong == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int parse_size(const char *text, size_t *value)
+{
+    char *end;
+    unsigned long parsed = strtoul(text, &end, 10);
+
+    if (*text == '\0' || *end != '\0' || parsed == 0) return 0;
+    *value = parsed;
+    return 1;
+}
+
+/*
+ * Connections
+ */
+
+static void *run_client(void *argument)
+{
+    load_client *client = argument;
+    int fd;
+
+    int batch;
+
+    client->sent_at = malloc(client->depth * sizeof(struct timespec));
+    client->failed = !client->sent_at;
+    for (batch = 0; batch < DISTINCT_BATCHES && !client->failed; batch++) {
+        client->failed = !prepare_batch(client, &client->prepared[batch]);
+    }
+
+    if (!client->failed) {
+        fd = connect_to(client->path);
+        client->failed = (fd < 0) || !exchange_batches(client, fd);
+        if (fd >= 0) close(fd);
+    }
+
+    for (batch = 0; batch < DISTINCT_BATCHES; batch++) {
+        free(client->prepared[batch].bytes);
+        free(client->prepared[batch].expected);
+    }
+    free(client->sent_at);
+    return NULL;
+}
+
+/** Retries for a while, so the daemon may still be starting up. */
+static int connect_to(const char *path)
+{
+    struct sockaddr_un address;
+    struct timespec pause = {0, 20 * 1000 * 1000};
+    int fd;
+
+    int attempt;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "roman_loadgen: socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    for (attempt = 0; attempt < CONNECT_ATTEMPTS; attempt++) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) break;
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0) {
+            if (fcntl(fd, F_SETFL, O_NONBLOCK) == 0) return fd;
+            break;
+        }
+        close(fd);
+        fd = -1;
+        if (errno != ENOENT && errno != ECONNREFUSED) break;
+        nanosleep(&pause, NULL);
+    }
+
+    perror(path);
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+/**
+ * Fill a batch with random requests on values up to MAXIMUM_VALUE and note
+ * what the daemon should answer to each.
+ */
+static int prepare_batch(load_client *client, prepared_batch *batch)
+{
+    char numerals[2][32];
+    size_t lengths[2];
+    uint64_t values[2];
+    char operation;
+    unsigned char *request;
+    size_t body_length = PROTOCOL_LENGTH_SIZE;
+
+    size_t index;
+    int which;
+
+    batch->bytes = malloc(PROTOCOL_LENGTH_SIZE + PROTOCOL_LENGTH_SIZE
+                          + client->batch_size
+                            * (PROTOCOL_REQUEST_HEADER_SIZE
+                               + 2 * sizeof(numerals[0])));
+    batch->expected = malloc(client->batch_size * sizeof(expected_result));
+    if (!batch->bytes || !batch->expected) return 0;
+
+    for (index = 0; index < client->batch_size; index++) {
+        for (which = 0; which < 2; which++) {
+            values[which] = rand_r(&client->seed) % MAXIMUM_VALUE + 1;
+            lengths[which] = u64_to_roman(values[which], numerals[which],
+                                          sizeof(numerals[which]));
+        }
+        operation = (rand_r(&client->seed) % 2) ? '+' : '-';
+
+        if (index % INVALID_EVERY == INVALID_EVERY - 1) {
+            strcpy(numerals[1], INVALID_NUMERAL);
+            lengths[1] = strlen(INVALID_NUMERAL);
+            batch->expected[index].status = ROMAN_ERR_INVALID_CHARACTER;
+            batch->expected[index].value = 0;
+        } else if (operation == '+') {
+            batch->expected[index].status = ROMAN_OK;
+            batch->expected[index].value = values[0] + values[1];
+        } else if (values[0] >= values[1]) {
+            batch->expected[index].status = ROMAN_OK;
+            batch->expected[index].value = values[0] - values[1];
+        } else {
+            batch->expected[index].status = ROMAN_ERR_NEGATIVE_RESULT;
+            batch->expected[index].value = 0;
+        }
+
+        request = batch->bytes + PROTOCOL_LENGTH_SIZE + body_length;
+        request[0] = (unsigned char)operation;
+        protocol_put_u32(request + 1, (uint32_t)lengths[0]);
+        protocol_put_u32(request + 5, (uint32_t)lengths[1]);
+        memcpy(request + PROTOCOL_REQUEST_HEADER_SIZE, numerals[0],
+               lengths[0]);
+        memcpy(request + PROTOCOL_REQUEST_HEADER_SIZE + lengths[0],
+               numerals[1], lengths[1]);
+        body_length += PROTOCOL_REQUEST_HEADER_SIZE + lengths[0] + lengths[1];
+    }
+
+    protocol_put_u32(batch->bytes, (uint32_t)body_length);
+    protocol_put_u32(batch->bytes + PROTOCOL_LENGTH_SIZE,
+                     (uint32_t)client->batch_size);
+    batch->length = PROTOCOL_LENGTH_SIZE + body_length;
+    return 1;
+}
+
+/**
+ * Send the batches, keeping no more than depth of them unanswered, while
+ * reading and checking responses as they come in.
+ */
+static int exchange_batches(load_client *client, int fd)
+{
+    unsigned char *input = NULL;
+    size_t input_length = 0;
+    size_t input_capacity = 0;
+    size_t sent = 0;
+    size_t sent_bytes = 0;
+    size_t received = 0;
+    size_t consumed;
+    const prepared_batch *sending;
+    struct pollfd descriptor;
+    ssize_t transferred;
+    unsigned char *larger_input;
+
+    descriptor.fd = fd;
+    while (received < client->batches) {
+        descriptor.events = POLLIN;
+        if (sent < client->batches && sent - received < client->depth) {
+            descriptor.events |= POLLOUT;
+        }
+        if (poll(&descriptor, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (descriptor.revents & POLLOUT) {
+            sending = &client->prepared[sent % DISTINCT_BATCHES];
+            if (sent_bytes == 0) {
+                clock_gettime(CLOCK_MONOTONIC,
+                              &client->sent_at[sent % client->depth]);
+            }
+            transferred = write(fd, sending->bytes + sent_bytes,
+                                sending->length - sent_bytes);
+            if (transferred < 0 && errno != EAGAIN && errno != EINTR) break;
+            if (transferred > 0) sent_bytes += transferred;
+            if (sent_bytes == sending->length) {
+                sent++;
+                sent_bytes = 0;
+            }
+        }
+
+        if (descriptor.revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (input_capacity - input_length < READ_SIZE) {
+                larger_input = realloc(input, input_capacity * 2 + READ_SIZE);
+                if (!larger_input) break;
+                input = larger_input;
+                input_capacity = input_capacity * 2 + READ_SIZE;
+            }
+            transferred = read(fd, input + input_length,
+                               input_capacity - input_length);
+            if (transferred == 0) break;
+            if (transferred < 0 && errno != EAGAIN && errno != EINTR) break;
+            if (transferred > 0) input_length += transferred;
+
+            consumed = check_responses(client, input, input_length,
+                                       &received);
+            input_length -= consumed;
+            memmove(input, input + consumed, input_length);
+        }
+    }
+
+    free(input);
+    return received == client->batches;
+}
+
+/**
+ * Check every complete response in input, noting its latency; returns the
+ * number of bytes they took up.
+ */
+static size_t check_responses(load_client *client, const unsigned char *input,
+                              size_t length, size_t *received)
+{
+    struct timespec now;
+    size_t consumed = 0;
+    size_t body_length;
+
+    while (length - consumed >= PROTOCOL_LENGTH_SIZE) {
+        body_length = protocol_get_u32(input + consumed);
+        if (length - consumed - PROTOCOL_LENGTH_SIZE < body_length) break;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        client->latencies[*received]
+            = seconds_between(&client->sent_at[*received % client->depth],
+                              &now);
+        client->wrong += check_response(
+            client, input + consumed + PROTOCOL_LENGTH_SIZE, body_length,
+            client->prepared[*received % DISTINCT_BATCHES].expected);
+
+        (*received)++;
+        consumed += PROTOCOL_LENGTH_SIZE + body_length;
+    }
+    return consumed;
+}
+
+/** Returns the number of results that are not what was expected. */
+static unsigned long long check_response(const load_client *client,
+                                         const unsigned char *body,
+                                         size_t body_length,
+                                         const expected_result *expected)
+{
+    const unsigned char *entry = body + PROTOCOL_LENGTH_SIZE;
+    size_t text_offset = PROTOCOL_LENGTH_SIZE
+                         + client->batch_size * PROTOCOL_RESULT_HEADER_SIZE;
+    unsigned long long wrong = 0;
+    size_t length;
+    uint64_t value;
+
+    size_t index;
+
+    if (body_length < text_offset
+        || protocol_get_u32(body) != client->batch_size) {
+        return client->batch_size;
+    }
+
+    for (index = 0; index < client->batch_size; index++) {
+        length = protocol_get_u32(entry + 1);
+        if (length > body_length - text_offset) return client->batch_size;
+
+        value = 0;
+        if (entry[0] != expected[index].status
+            || (length > 0
+                && roman_to_u64_n((const char *)body + text_offset, length,
+                                  &value) != ROMAN_OK)
+            || value != expected[index].value) {
+            wrong++;
+        }
+
+        text_offset += length;
+        entry += PROTOCOL_RESULT_HEADER_SIZE;
+    }
+    return wrong + (text_offset != body_length);
+}
+
+static int compare_latencies(const void *latency1, const void *latency2)
+{
+    double difference = *(const double *)latency1 - *(const double *)latency2;
+    return (difference > 0) - (difference < 0);
+}
+
+static double seconds_between(const struct timespec *start,
+                              const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec)
+           + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--connections N] [--batches N] "
+                    "[--batch-size N] [--depth N] socket\n", program);
+}
@@ -0,0 +1,38 @@
+/* roman_protocol.c */
+
+#include "roman_protocol.h"
+
+void protocol_put_u32(unsigned char *bytes, uint32_t value)
+{
+    bytes[0] = (unsigned char)(value >> 24);
+    bytes[1] = (unsigned char)(value >> 16);
+    bytes[2] = (unsigned char)(value >> 8);
+    bytes[3] = (unsigned char)value;
+}
+
+uint32_t protocol_get_u32(const unsigned char *bytes)
+{
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16)
+           | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+size_t protocol_read_request(const unsigned char *body, size_t body_length,
+                             size_t offset, char *operation,
+                             const char **numeral1, size_t *length1,
+                             const char **numeral2, size_t *length2)
+{
+    if (body_length - offset < PROTOCOL_REQUEST_HEADER_SIZE) return 0;
+
+    *operation = (char)body[offset];
+    *length1 = protocol_get_u32(body + offset + 1);
+    *length2 = protocol_get_u32(body + offset + 5);
+    offset += PROTOCOL_REQUEST_HEADER_SIZE;
+
+    /* Compared one at a time, so that the lengths cannot overflow a sum. */
+    if (*length1 > body_length - offset) return 0;
+    *numeral1 = (const char *)body + offset;
+    offset += *length1;
+    if (*length2 > body_length - offset) return 0;
+    *numeral2 = (const char *)body + offset;
+    return offset + *length2;
+}
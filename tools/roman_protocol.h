@@ -0,0 +1,49 @@
+/* roman_protocol.h */
+#ifndef ROMAN_PROTOCOL_H
+#define ROMAN_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The wire format spoken by roman_daemon and roman_loadgen over a Unix domain
+ * socket. Clients send batches of requests, as many as they like without
+ * waiting for answers, and get one response per batch, in order. Every
+ * integer is a big-endian uint32 unless it is a single byte.
+ *
+ * A batch is its body length followed by the body, which is the number of
+ * requests and then each request in turn:
+ *
+ *     body length | count | request ...
+ *     request:    operation ('+' or '-') | length1 | length2 | numeral1 |
+ *                 numeral2
+ *
+ * A response is its body length followed by the body, which is the number of
+ * results, a status byte (a roman_status) and length for each, and then the
+ * text of every result back to back with no '\0' in between:
+ *
+ *     body length | count | (status | length) ... | text ...
+ *
+ * A failed request has a nonzero status and no text. A batch that does not
+ * parse, or whose body is longer than PROTOCOL_MAXIMUM_BODY, makes the daemon
+ * close the connection.
+ */
+#define PROTOCOL_LENGTH_SIZE 4
+#define PROTOCOL_REQUEST_HEADER_SIZE 9
+#define PROTOCOL_RESULT_HEADER_SIZE 5
+#define PROTOCOL_MAXIMUM_BODY (16 * 1024 * 1024)
+
+void     protocol_put_u32(unsigned char *bytes, uint32_t value);
+uint32_t protocol_get_u32(const unsigned char *bytes);
+
+/*
+ * Reads the request at offset in a batch body, checking that it lies within
+ * the body. Returns the offset of the next request, or 0 if this one runs
+ * past the end.
+ */
+size_t   protocol_read_request(const unsigned char *body, size_t body_length,
+                               size_t offset, char *operation,
+                               const char **numeral1, size_t *length1,
+                               const char **numeral2, size_t *length2);
+
+#endif